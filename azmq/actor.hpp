@@ -74,6 +74,60 @@ AZMQ_V1_INLINE_NAMESPACE_BEGIN
                                             std::forward<Args>(args)...));
     }
 
+    /** \brief fixed size set of threads which actors can be spawned on, see
+     *  spawn_on()
+     */
+    using pool = detail::actor_pool;
+
+    /** \brief create an actor multiplexed over a pool of threads, bound to
+     *  one end of a pipe (pair of inproc sockets)
+     *  \param p pool to run the actor on
+     *  \param peer io_service to associate the peer (caller) end of the pipe
+     *  \param defer_start bool, if true the actor is started by setting the
+     *         'start' option on the returned socket
+     *  \param f Function accepting socket& as the first parameter and a
+     *           number of additional args
+     *  \returns peer socket
+     *
+     *  \remark Unlike spawn(), no thread or io_service is created for the
+     *  actor. Its socket is created on a strand of the pool's io_service and
+     *  f is invoked on that strand. f must not block, it should start
+     *  asynchronous operations on the supplied socket and return. Handlers
+     *  for those operations run on the same strand, so an actor never runs
+     *  concurrently with itself.
+     *
+     *  \remark The actor is alive until f throws or the returned socket is
+     *  destroyed. Destroying the socket cancels the actor's outstanding
+     *  operations and waits for their handlers to run, unless it happens on
+     *  one of the pool's threads or the 'detached' option is set. The
+     *  is_alive, detached, start and last_error options behave as they do for
+     *  spawn(). An exception thrown by a completion handler of an operation on
+     *  the actor's socket stops the actor just as one thrown by f does, and
+     *  is reported by last_error. Exceptions from other work on the pool's
+     *  threads are reported by pool::last_error().
+     */
+    template<typename Function, typename... Args>
+    socket spawn_on(pool & p, asio::io_service & peer, bool defer_start, Function && f, Args&&... args) {
+        return detail::actor_service::make_pipe(p, peer, defer_start,
+                                                std::bind(std::forward<Function>(f),
+                                                          std::placeholders::_1,
+                                                          std::forward<Args>(args)...));
+    }
+
+    /** \brief create an actor multiplexed over a pool of threads, the peer
+     *  end of the pipe is also associated with the pool's io_service
+     *  \remark If pool::reserve() has been called the pipe is taken from the
+     *  pool's ready pipes, making the spawn itself a matter of microseconds.
+     *  \see spawn_on(pool &, asio::io_service &, bool, Function &&, Args&&...)
+     */
+    template<typename Function, typename... Args>
+    socket spawn_on(pool & p, Function && f, Args&&... args) {
+        return detail::actor_service::make_pipe(p, p.get_io_service(), false,
+                                                std::bind(std::forward<Function>(f),
+                                                          std::placeholders::_1,
+                                                          std::forward<Args>(args)...));
+    }
+
 AZMQ_V1_INLINE_NAMESPACE_END
 } // namespace actor
 } // namespace azmq
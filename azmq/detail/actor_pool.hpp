@@ -0,0 +1,191 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_DETAIL_ACTOR_POOL_HPP_
+#define AZMQ_DETAIL_ACTOR_POOL_HPP_
+
+#include "../socket.hpp"
+#include "config/thread.hpp"
+#include "config/mutex.hpp"
+#include "config/unique_lock.hpp"
+
+#include <asio/io_service.hpp>
+#include <asio/strand.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace azmq {
+namespace detail {
+    /** \brief connected pair of inproc sockets, the actor end running on its
+     *  own strand of an actor_pool's io_service
+     */
+    struct actor_pipe {
+        asio::io_service::strand strand;
+        pair_socket actor;
+        pair_socket peer;
+
+        actor_pipe(asio::io_service & ios, asio::io_service & peer_ios)
+            : strand(ios)
+            , actor(strand)
+            , peer(peer_ios)
+        {
+            static std::atomic_ulong id{ 0 };
+            auto uri = "inproc://azmq-pool-" + std::to_string(id++);
+            actor.bind(uri);
+            peer.connect(uri);
+        }
+    };
+
+    /** \brief Fixed set of threads running one shared io_service, actors
+     *  spawned with actor::spawn_on() are multiplexed over it.
+     *  \remark Every thread takes the next ready handler from the shared
+     *  io_service queue, so an idle thread always picks up work that a busy
+     *  one has not got to. Each actor runs on its own strand.
+     */
+    class actor_pool {
+    public:
+        /** \brief start threads, at least one
+         *  \param threads size_t, defaults to the hardware concurrency
+         */
+        explicit actor_pool(size_t threads = thread_t::hardware_concurrency())
+            : work_(new asio::io_service::work(io_service_))
+        {
+            threads = std::max<size_t>(1, threads);
+            threads_.reserve(threads);
+            for (size_t i = 0; i != threads; ++i)
+                threads_.emplace_back([this] { run(); });
+        }
+
+        /** \brief stop the io_service and join the threads
+         *  \remark actors should be joined, by destroying their peer sockets,
+         *  before the pool is destroyed
+         */
+        ~actor_pool() {
+            work_.reset();
+            io_service_.stop();
+            for (auto & t : threads_)
+                t.join();
+        }
+
+        actor_pool(actor_pool const&) = delete;
+        actor_pool & operator=(actor_pool const&) = delete;
+
+        asio::io_service & get_io_service() { return io_service_; }
+
+        size_t size() const { return threads_.size(); }
+
+        /** \brief the last exception thrown on the pool's threads by work
+         *  not belonging to any one actor, such as a handler posted to the
+         *  pool's io_service or the creation of a reserved pipe
+         *  \remark the threads carry on after such an exception
+         */
+        std::exception_ptr last_error() const {
+            lock_type l{ mutex_ };
+            return last_error_;
+        }
+
+        /** \brief true if called from one of this pool's threads */
+        bool running_in_this_thread() const { return current() == this; }
+
+        /** \brief keep n pipes ready for actors spawned with both ends on
+         *  this pool, spawn_on(pool &, Function &&, Args&&...)
+         *  \param n size_t
+         *  \remark Creating, binding and connecting the pipe's sockets
+         *  dominates the cost of spawning a pooled actor. With a reserve
+         *  that work is done ahead of time on the pool's threads, and each
+         *  pipe taken is replaced in the background.
+         */
+        void reserve(size_t n) {
+            {
+                lock_type l{ mutex_ };
+                reserve_ = n;
+            }
+            refill();
+        }
+
+        /** \brief a pipe with both ends on this pool, from the reserve if one
+         *  is ready
+         */
+        actor_pipe take_pipe() {
+            {
+                lock_type l{ mutex_ };
+                if (!pipes_.empty()) {
+                    actor_pipe res(std::move(pipes_.back()));
+                    pipes_.pop_back();
+                    l.unlock();
+                    refill();
+                    return res;
+                }
+            }
+            return actor_pipe(io_service_, io_service_);
+        }
+
+    private:
+        using lock_type = unique_lock_t<mutex_t>;
+
+        asio::io_service io_service_;
+        std::unique_ptr<asio::io_service::work> work_;
+        std::vector<thread_t> threads_;
+        mutable lock_type::mutex_type mutex_;
+        std::vector<actor_pipe> pipes_;
+        size_t reserve_ = 0;
+        size_t filling_ = 0;
+        std::exception_ptr last_error_;
+
+        static actor_pool const*& current() {
+            static thread_local actor_pool const* p = nullptr;
+            return p;
+        }
+
+        // at most one refill is queued or running per missing pipe
+        void refill() {
+            lock_type l{ mutex_ };
+            if (pipes_.size() + filling_ >= reserve_)
+                return;
+            ++filling_;
+            l.unlock();
+            io_service_.post([this] {
+                try {
+                    actor_pipe p(io_service_, io_service_);
+                    lock_type l{ mutex_ };
+                    pipes_.push_back(std::move(p));
+                    --filling_;
+                } catch (...) {
+                    lock_type l{ mutex_ };
+                    --filling_;
+                    last_error_ = std::current_exception();
+                    return;
+                }
+                refill();
+            });
+        }
+
+        // exceptions from an actor's own handlers stop that actor, see
+        // actor_service, anything else which escapes is kept as last_error
+        void run() {
+            current() = this;
+            while (true) {
+                try {
+                    io_service_.run();
+                    return;
+                } catch (...) {
+                    lock_type l{ mutex_ };
+                    last_error_ = std::current_exception();
+                }
+            }
+        }
+    };
+} // namespace detail
+} // namespace azmq
+#endif // AZMQ_DETAIL_ACTOR_POOL_HPP_
@@ -13,6 +13,7 @@
 #include "../socket.hpp"
 #include "../option.hpp"
 #include "service_base.hpp"
+#include "actor_pool.hpp"
 #include "socket_service.hpp"
 #include "config/thread.hpp"
 #include "config/mutex.hpp"
@@ -21,12 +22,12 @@
 
 #include <cassert>
 #include <asio/signal_set.hpp>
+#include <asio/strand.hpp>
 
 #include <string>
 #include <vector>
 #include <memory>
 #include <atomic>
-#include <sstream>
 #include <exception>
 
 namespace azmq {
@@ -56,10 +57,20 @@ namespace detail {
         static socket make_pipe(asio::io_service & ios, bool defer_start, T&& data) {
             auto p = std::make_shared<model<T>>(std::forward<T>(data));
             auto res = p->peer_socket(ios);
-            associate_ext(res, handler(std::move(p), defer_start));
+            associate_ext(res, handler<concept>(std::move(p), defer_start));
             return std::move(res);
         }
 
+        template<typename T>
+        static socket make_pipe(actor_pool & pool, asio::io_service & ios, bool defer_start, T&& data) {
+            auto pipe = &ios == &pool.get_io_service() ? pool.take_pipe()
+                                                       : actor_pipe(pool.get_io_service(), ios);
+            auto p = std::make_shared<pool_model<T>>(pool, pipe, std::forward<T>(data));
+            socket res(std::move(pipe.peer));
+            associate_ext(res, handler<pool_concept>(std::move(p), defer_start));
+            return res;
+        }
+
     private:
         struct concept {
             using ptr = std::shared_ptr<concept>;
@@ -142,8 +153,10 @@ namespace detail {
 
             static void run(ptr p) {
                 lock_type l { p->mutex_ };
-                p->signals_.async_wait([p](asio::error_code const&, int) {
-                    p->io_service_.stop();
+                // the handler lives in io_service_, so must not own p
+                auto ios = &p->io_service_;
+                p->signals_.async_wait([ios](asio::error_code const&, int) {
+                    ios->stop();
                 });
                 p->stopped_ = false;
                 p->thread_ = thread_t([p] {
@@ -169,11 +182,140 @@ namespace detail {
             void run() override { data_(socket_); }
         };
 
+        // actor multiplexed over an actor_pool, its socket and everything
+        // the actor function starts on it run on the actor's strand
+        struct pool_concept : std::enable_shared_from_this<pool_concept> {
+            using ptr = std::shared_ptr<pool_concept>;
+
+            actor_pool & pool_;
+            asio::io_service::strand strand_;
+            pair_socket socket_;
+
+            using lock_type = unique_lock_t<mutex_t>;
+            mutable lock_type::mutex_type mutex_;
+            mutable condition_variable_t cv_;
+            bool started_;
+            bool stopped_;
+            bool detached_;
+            std::exception_ptr last_error_;
+
+            pool_concept(actor_pool & pool, actor_pipe & pipe)
+                : pool_(pool)
+                , strand_(pipe.strand)
+                , socket_(std::move(pipe.actor))
+                , started_(false)
+                , stopped_(true)
+                , detached_(false)
+            { }
+
+            virtual ~pool_concept() = default;
+
+            bool joinable() const {
+                lock_type l{ mutex_ };
+                return !detached_;
+            }
+
+            // cancel whatever the actor has outstanding on its socket, then
+            // wait for the aborted handlers, which the strand runs ahead of
+            // the final post. Waiting is skipped on the pool's own threads,
+            // which might be the only ones able to run the strand.
+            void stop() {
+                {
+                    lock_type l{ mutex_ };
+                    if (!started_ || stopped_ || detached_)
+                        return;
+                }
+                auto p = shared_from_this();
+                strand_.post([p] { p->finish(); });
+                if (pool_.running_in_this_thread())
+                    return;
+                lock_type l{ mutex_ };
+                cv_.wait(l, [this] { return stopped_; });
+            }
+
+            void finish() {
+                asio::error_code ec;
+                socket_.cancel(ec);
+                auto p = shared_from_this();
+                strand_.post([p] { p->stopped(); });
+            }
+
+            void stopped() {
+                {
+                    lock_type l{ mutex_ };
+                    stopped_ = true;
+                }
+                cv_.notify_all();
+            }
+
+            bool is_stopped() const {
+                lock_type l{ mutex_ };
+                return stopped_;
+            }
+
+            void detach() {
+                lock_type l{ mutex_ };
+                detached_ = true;
+            }
+
+            void set_last_error(std::exception_ptr last_error) {
+                lock_type l { mutex_ };
+                last_error_ = last_error;
+            }
+
+            std::exception_ptr last_error() const {
+                lock_type l { mutex_ };
+                return last_error_;
+            }
+
+            virtual void run() = 0;
+
+            static void run(ptr p) {
+                {
+                    lock_type l { p->mutex_ };
+                    p->started_ = true;
+                    p->stopped_ = false;
+                }
+                // a handler which throws stops the actor as f throwing does,
+                // rather than unwinding into the pool's thread
+                std::weak_ptr<pool_concept> w = p;
+                socket_service::core_access access{ p->socket_ };
+                access.service().set_handler_error(access.implementation(),
+                    [w](std::exception_ptr e) {
+                        if (auto p = w.lock()) {
+                            p->set_last_error(e);
+                            p->finish();
+                        }
+                    });
+                p->strand_.post([p] {
+                    try {
+                        p->run();
+                    } catch (...) {
+                        p->set_last_error(std::current_exception());
+                        p->finish();
+                    }
+                });
+            }
+        };
+
+        template<typename Function>
+        struct pool_model : pool_concept {
+            Function data_;
+
+            pool_model(actor_pool & pool, actor_pipe & pipe, Function data)
+                : pool_concept(pool, pipe)
+                , data_(std::move(data))
+            { }
+
+            void run() override { data_(socket_); }
+        };
+
+        template<typename Concept>
         struct handler {
-            concept::ptr p_;
+            typename Concept::ptr p_;
             bool defer_start_;
 
-            handler(concept::ptr p, bool defer_start)
+            handler(typename Concept::ptr p, bool defer_start)
                 : p_(std::move(p))
                 , defer_start_(defer_start)
             { }
@@ -181,7 +323,7 @@ namespace detail {
             void on_install(asio::io_service&, void*) {
                 if (defer_start_) return;
                 defer_start_ = false;
-                concept::run(p_);
+                Concept::run(p_);
             }
 
             void on_remove() {
@@ -206,7 +348,7 @@ namespace detail {
                     {
                         if (*static_cast<start::value_t const*>(opt.data()) && defer_start_) {
                             defer_start_ = false;
-                            concept::run(p_);
+                            Concept::run(p_);
                         }
                     }
                     break;
@@ -256,9 +398,7 @@ namespace detail {
 
     std::string actor_service::get_uri(const char* pfx) {
         static std::atomic_ulong id{ 0 };
-        std::ostringstream stm;
-        stm << "inproc://azmq-" << pfx << "-" << id++;
-        return stm.str();
+        return std::string("inproc://azmq-") + pfx + "-" + std::to_string(id++);
     }
 
 } // namespace detail
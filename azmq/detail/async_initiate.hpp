@@ -0,0 +1,63 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_DETAIL_ASYNC_INITIATE_HPP_
+#define AZMQ_DETAIL_ASYNC_INITIATE_HPP_
+
+#include <asio/version.hpp>
+#include <asio/async_result.hpp>
+#if ASIO_VERSION < 101400
+#include <asio/handler_type.hpp>
+#endif
+
+#include <type_traits>
+#include <utility>
+
+namespace azmq {
+namespace detail {
+#if ASIO_VERSION >= 101400
+    /** \brief return type of an initiating function taking CompletionToken */
+    template<typename CompletionToken, typename Signature>
+    using async_result_t = typename asio::async_result<typename std::decay<CompletionToken>::type,
+                                                       Signature>::return_type;
+
+    /** \brief turn token into a completion handler, pass it to initiation
+     *  along with args and return whatever the token's async_result produces
+     *  \remark Tokens such as asio::deferred and asio::use_awaitable start
+     *  the operation after the initiating function has returned, so
+     *  initiation and args are decay copied by the token. Arguments of the
+     *  initiating function must be passed through args, never referred to
+     *  from initiation.
+     */
+    template<typename Signature, typename CompletionToken, typename Initiation, typename... Args>
+    async_result_t<CompletionToken, Signature> async_initiate(Initiation && initiation,
+                                                              CompletionToken & token,
+                                                              Args&&... args) {
+        return asio::async_initiate<CompletionToken, Signature>(std::forward<Initiation>(initiation), token,
+                                                                std::forward<Args>(args)...);
+    }
+#else
+    template<typename CompletionToken, typename Signature>
+    using async_result_t = typename asio::async_result<
+                                typename asio::handler_type<CompletionToken, Signature>::type
+                            >::type;
+
+    template<typename Signature, typename CompletionToken, typename Initiation, typename... Args>
+    async_result_t<CompletionToken, Signature> async_initiate(Initiation && initiation,
+                                                              CompletionToken & token,
+                                                              Args&&... args) {
+        using handler_type = typename asio::handler_type<CompletionToken, Signature>::type;
+        handler_type handler(std::forward<CompletionToken>(token));
+        asio::async_result<handler_type> result(handler);
+        initiation(std::move(handler), std::forward<Args>(args)...);
+        return result.get();
+    }
+#endif
+} // namespace detail
+} // namespace azmq
+#endif // AZMQ_DETAIL_ASYNC_INITIATE_HPP_
@@ -0,0 +1,249 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_DETAIL_HANDLER_ALLOC_HPP_
+#define AZMQ_DETAIL_HANDLER_ALLOC_HPP_
+
+#include <asio/version.hpp>
+#include <asio/handler_alloc_hook.hpp>
+#if ASIO_VERSION >= 101100
+#include <asio/associated_allocator.hpp>
+#endif
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace azmq {
+namespace detail {
+    /** \brief Lock-free cache of recently released blocks, used to recycle the
+     *  storage of reactor ops and internal completion handlers.
+     *  \remark Blocks remember their owner, so deallocate() does not need a
+     *  reference to the allocator they came from. Blocks from
+     *  allocate_unowned() have no owner and go straight back to the heap,
+     *  they may be freed after every allocator is gone.
+     */
+    class recycling_allocator {
+    public:
+        recycling_allocator() {
+            for (auto& s : slots_)
+                s.store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~recycling_allocator() {
+            for (auto& s : slots_)
+                ::operator delete(s.exchange(nullptr));
+        }
+
+        recycling_allocator(recycling_allocator const&) = delete;
+        recycling_allocator & operator=(recycling_allocator const&) = delete;
+
+        void* allocate(std::size_t size) {
+            auto chunks = (size + chunk_size - 1) / chunk_size;
+            for (auto& s : slots_) {
+                auto p = s.exchange(nullptr, std::memory_order_acquire);
+                if (!p)
+                    continue;
+                if (p->chunks_ >= chunks)
+                    return p + 1;
+                recycle(p);
+            }
+            auto p = static_cast<header*>(::operator new(sizeof(header) + chunks * chunk_size));
+            p->owner_ = this;
+            p->chunks_ = chunks;
+            return p + 1;
+        }
+
+        static void* allocate_unowned(std::size_t size) {
+            auto p = static_cast<header*>(::operator new(sizeof(header) + size));
+            p->owner_ = nullptr;
+            p->chunks_ = 0;
+            return p + 1;
+        }
+
+        static void deallocate(void* pv) {
+            if (!pv) return;
+            auto p = static_cast<header*>(pv) - 1;
+            if (p->owner_)
+                p->owner_->recycle(p);
+            else
+                ::operator delete(p);
+        }
+
+    private:
+        struct alignas(std::max_align_t) header {
+            recycling_allocator* owner_;
+            std::size_t chunks_;
+        };
+
+        enum {
+            chunk_size = 64,
+            max_slots = 8
+        };
+
+        std::array<std::atomic<header*>, max_slots> slots_;
+
+        void recycle(header* p) {
+            for (auto& s : slots_) {
+                header* expected = nullptr;
+                if (s.compare_exchange_strong(expected, p, std::memory_order_release,
+                                                           std::memory_order_relaxed))
+                    return;
+            }
+            ::operator delete(p);
+        }
+    };
+
+    /** \brief true for ops whose storage is only ever freed from the
+     *  reactor, or from a completion posted to the io_service, while the
+     *  socket_service owning the recycling_allocator is alive. Ops which
+     *  libzmq may free from its own threads at any later time specialize
+     *  this as false, and are allocated unowned when their handler brings
+     *  no allocator of its own.
+     */
+    template<typename Op>
+    struct completes_in_reactor : std::true_type { };
+
+    /** \brief true if ADL finds an asio_handler_allocate hook for Handler */
+    template<typename Handler>
+    class has_alloc_hook {
+        template<typename H>
+        static auto test(H* h) -> decltype(asio_handler_allocate(std::size_t(), h), std::true_type());
+
+        template<typename>
+        static std::false_type test(...);
+
+    public:
+        static constexpr bool value = decltype(test<Handler>(nullptr))::value;
+    };
+
+#if ASIO_VERSION >= 101100
+    /** \brief true if Handler has an associated allocator other than the
+     *  default std::allocator<void>
+     */
+    template<typename Handler>
+    struct has_associated_allocator
+        : std::integral_constant<bool, !std::is_same<typename asio::associated_allocator<Handler>::type,
+                                                     std::allocator<void>>::value> { };
+
+    // storage unit requested from associated allocators, keeps ops suitably
+    // aligned whatever value_type the allocator was declared with
+    struct alignas(std::max_align_t) handler_block {
+        unsigned char data_[alignof(std::max_align_t)];
+    };
+
+    template<typename Handler>
+    using handler_block_allocator = typename std::allocator_traits<
+            typename asio::associated_allocator<Handler>::type
+        >::template rebind_alloc<handler_block>;
+#else
+    template<typename Handler>
+    struct has_associated_allocator : std::false_type { };
+#endif
+
+    /** \brief Storage for operations carrying a Handler. Handlers with an
+     *  associated allocator get their op allocated from it, handlers which
+     *  supply their own asio_handler_allocate/asio_handler_deallocate hooks
+     *  are honoured, all others are served from the supplied
+     *  recycling_allocator.
+     */
+    struct handler_alloc {
+#if ASIO_VERSION >= 101100
+        template<typename Handler>
+        static auto allocate(std::size_t size, Handler & h, recycling_allocator &) ->
+            typename std::enable_if<has_associated_allocator<Handler>::value, void*>::type
+        {
+            handler_block_allocator<Handler> a(asio::get_associated_allocator(h));
+            return std::allocator_traits<handler_block_allocator<Handler>>::allocate(a, blocks(size));
+        }
+
+        template<typename Handler>
+        static auto deallocate(void* p, std::size_t size, Handler & h) ->
+            typename std::enable_if<has_associated_allocator<Handler>::value>::type
+        {
+            handler_block_allocator<Handler> a(asio::get_associated_allocator(h));
+            std::allocator_traits<handler_block_allocator<Handler>>::deallocate(a,
+                                        static_cast<handler_block*>(p), blocks(size));
+        }
+#endif
+
+        template<typename Handler>
+        static auto allocate(std::size_t size, Handler & h, recycling_allocator &) ->
+            typename std::enable_if<!has_associated_allocator<Handler>::value &&
+                                    has_alloc_hook<Handler>::value, void*>::type
+        {
+            using asio::asio_handler_allocate;
+            return asio_handler_allocate(size, std::addressof(h));
+        }
+
+        template<typename Handler>
+        static auto allocate(std::size_t size, Handler &, recycling_allocator & a) ->
+            typename std::enable_if<!has_associated_allocator<Handler>::value &&
+                                    !has_alloc_hook<Handler>::value, void*>::type
+        {
+            return a.allocate(size);
+        }
+
+        /** \brief storage for an Op, from a unless the op may outlive it */
+        template<typename Op, typename Handler>
+        static auto allocate_op(Handler & h, recycling_allocator & a) ->
+            typename std::enable_if<completes_in_reactor<Op>::value ||
+                                    has_associated_allocator<Handler>::value ||
+                                    has_alloc_hook<Handler>::value, void*>::type
+        {
+            return allocate(sizeof(Op), h, a);
+        }
+
+        template<typename Op, typename Handler>
+        static auto allocate_op(Handler &, recycling_allocator &) ->
+            typename std::enable_if<!completes_in_reactor<Op>::value &&
+                                    !has_associated_allocator<Handler>::value &&
+                                    !has_alloc_hook<Handler>::value, void*>::type
+        {
+            return recycling_allocator::allocate_unowned(sizeof(Op));
+        }
+
+        template<typename Handler>
+        static auto deallocate(void* p, std::size_t size, Handler & h) ->
+            typename std::enable_if<!has_associated_allocator<Handler>::value &&
+                                    has_alloc_hook<Handler>::value>::type
+        {
+            using asio::asio_handler_deallocate;
+            asio_handler_deallocate(p, size, std::addressof(h));
+        }
+
+        template<typename Handler>
+        static auto deallocate(void* p, std::size_t, Handler &) ->
+            typename std::enable_if<!has_associated_allocator<Handler>::value &&
+                                    !has_alloc_hook<Handler>::value>::type
+        {
+            recycling_allocator::deallocate(p);
+        }
+
+        /** \brief destroy op and release its storage, h should be the handler
+         *  moved out of op
+         */
+        template<typename Op, typename Handler>
+        static void destroy(Op* op, Handler & h) {
+            op->~Op();
+            deallocate(op, sizeof(Op), h);
+        }
+
+#if ASIO_VERSION >= 101100
+    private:
+        static std::size_t blocks(std::size_t size) {
+            return (size + sizeof(handler_block) - 1) / sizeof(handler_block);
+        }
+#endif
+    };
+} // namespace detail
+} // namespace azmq
+#endif // AZMQ_DETAIL_HANDLER_ALLOC_HPP_
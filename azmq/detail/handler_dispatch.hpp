@@ -0,0 +1,106 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_DETAIL_HANDLER_DISPATCH_HPP_
+#define AZMQ_DETAIL_HANDLER_DISPATCH_HPP_
+
+#include <asio/version.hpp>
+#if ASIO_VERSION >= 101100
+#include <asio/associated_allocator.hpp>
+#include <asio/associated_executor.hpp>
+#include <asio/dispatch.hpp>
+#include <asio/system_executor.hpp>
+#endif
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace azmq {
+namespace detail {
+#if ASIO_VERSION >= 101100
+    /** \brief true if Handler is bound to an executor, e.g. a strand, rather
+     *  than the default system_executor
+     */
+    template<typename Handler>
+    struct has_associated_executor
+        : std::integral_constant<bool, !std::is_same<typename asio::associated_executor<Handler>::type,
+                                                     asio::system_executor>::value> { };
+
+    // handler plus completion arguments, run through the handler's executor.
+    // Arguments passed as lvalues reach the handler as lvalues, so handlers
+    // taking e.g. message& keep working.
+    template<typename Handler, typename... Args>
+    class handler_binder {
+    public:
+        using allocator_type = typename asio::associated_allocator<Handler>::type;
+
+        handler_binder(Handler && handler, Args &&... args)
+            : handler_(std::move(handler))
+            , args_(std::move(args)...)
+        { }
+
+        allocator_type get_allocator() const noexcept {
+            return asio::get_associated_allocator(handler_);
+        }
+
+        void operator()() {
+            invoke(std::integral_constant<size_t, sizeof...(Args)>());
+        }
+
+    private:
+        using args_type = std::tuple<typename std::decay<Args>::type...>;
+        template<size_t I>
+        using arg_type = typename std::tuple_element<I, std::tuple<Args&&...>>::type;
+
+        Handler handler_;
+        args_type args_;
+
+        // completion signatures have two or three arguments
+        void invoke(std::integral_constant<size_t, 2>) {
+            handler_(static_cast<arg_type<0>>(std::get<0>(args_)),
+                     static_cast<arg_type<1>>(std::get<1>(args_)));
+        }
+
+        void invoke(std::integral_constant<size_t, 3>) {
+            handler_(static_cast<arg_type<0>>(std::get<0>(args_)),
+                     static_cast<arg_type<1>>(std::get<1>(args_)),
+                     static_cast<arg_type<2>>(std::get<2>(args_)));
+        }
+    };
+#else
+    template<typename Handler>
+    struct has_associated_executor : std::false_type { };
+#endif
+
+    /** \brief invoke the completion handler of an op, h has already been
+     *  moved out of the op.
+     *  \remark Handlers with an associated executor are dispatched through
+     *  it, which runs them inline when the calling thread is already inside
+     *  that executor. All others are invoked directly.
+     */
+    template<typename Handler, typename... Args>
+    auto dispatch_handler(Handler & h, Args &&... args) ->
+        typename std::enable_if<!has_associated_executor<Handler>::value>::type
+    {
+        h(std::forward<Args>(args)...);
+    }
+
+#if ASIO_VERSION >= 101100
+    template<typename Handler, typename... Args>
+    auto dispatch_handler(Handler & h, Args &&... args) ->
+        typename std::enable_if<has_associated_executor<Handler>::value>::type
+    {
+        auto ex = asio::get_associated_executor(h);
+        asio::dispatch(ex, handler_binder<Handler, Args...>(std::move(h), std::forward<Args>(args)...));
+    }
+#endif
+} // namespace detail
+} // namespace azmq
+#endif // AZMQ_DETAIL_HANDLER_DISPATCH_HPP_
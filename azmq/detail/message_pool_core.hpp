@@ -0,0 +1,256 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_DETAIL_MESSAGE_POOL_CORE_HPP_
+#define AZMQ_DETAIL_MESSAGE_POOL_CORE_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace azmq {
+namespace detail {
+    /** \brief Size-classed block storage behind azmq::message_pool.
+     *  \remark Each size class keeps a mutex protected central free list,
+     *  refilled a slab at a time. Every thread keeps a small magazine of
+     *  blocks per class for each of the last cached_pools pools it
+     *  allocated from. Blocks are returned by libzmq through release(), on
+     *  whichever thread drops the last reference to the frame. A thread
+     *  which has not allocated from the block's pool, such as a libzmq I/O
+     *  thread, returns it straight to the central free list.
+     *
+     *  The core is reference counted. The owning message_pool, each
+     *  magazine bound to it and each block outside the central free lists
+     *  hold a reference, so frames may outlive the message_pool.
+     */
+    class message_pool_core {
+    public:
+        enum : size_t {
+            min_class_log2 = 6,     // 64 bytes
+            max_class_log2 = 16,    // 64KiB
+            class_count = max_class_log2 - min_class_log2 + 1,
+            slab_bytes = 64 * 1024,
+            magazine_size = 32,
+            cached_pools = 4
+        };
+
+        struct alignas(std::max_align_t) block {
+            message_pool_core* owner_;
+            size_t size_class_;
+
+            void* data() { return this + 1; }
+        };
+
+        static message_pool_core* create() { return new message_pool_core(); }
+
+        static size_t max_size() { return size_t(1) << max_class_log2; }
+
+        /** \brief size class able to hold size bytes, size <= max_size() */
+        static size_t size_class(size_t size) {
+            size_t cls = 0;
+            while ((size_t(1) << (cls + min_class_log2)) < size)
+                ++cls;
+            return cls;
+        }
+
+        static size_t capacity(size_t cls) { return size_t(1) << (cls + min_class_log2); }
+
+        block* acquire(size_t cls) {
+            assert((cls < class_count)&&("invalid size class"));
+            if (cache_destroyed()) {
+                block* b;
+                refill(cls, &b, 1);
+                return b;
+            }
+            auto & m = cache().bind(this);
+            auto & n = m.counts_[cls];
+            if (!n)
+                n = refill(cls, m.blocks_[cls].data(), magazine_size / 2);
+            return m.blocks_[cls][--n];
+        }
+
+        /** \brief zmq_free_fn, hint is the block */
+        static void release(void*, void* hint) {
+            auto b = static_cast<block*>(hint);
+            b->owner_->release(b);
+        }
+
+        // never binds a magazine, libzmq I/O threads release frames of
+        // every pool without ever allocating from one
+        void release(block* b) {
+            auto m = cache_destroyed() ? nullptr
+                                       : cache().find(this);
+            if (!m) {
+                drain(b->size_class_, &b, 1);
+                return;
+            }
+            auto cls = b->size_class_;
+            auto & n = m->counts_[cls];
+            if (n == magazine_size) {
+                n -= magazine_size / 2;
+                drain(cls, m->blocks_[cls].data() + n, magazine_size / 2);
+            }
+            m->blocks_[cls][n++] = b;
+        }
+
+        /** \brief give the calling thread's cached blocks back to this core
+         *  and drop the magazine's reference
+         */
+        void flush_this_thread() {
+            if (cache_destroyed())
+                return;
+            if (auto m = cache().find(this))
+                m->flush();
+        }
+
+        void add_ref(size_t n = 1) { refs_.fetch_add(n, std::memory_order_relaxed); }
+
+        void release_ref(size_t n = 1) {
+            if (refs_.fetch_sub(n, std::memory_order_acq_rel) == n)
+                delete this;
+        }
+
+    private:
+        struct size_class_state {
+            std::mutex mutex_;
+            std::vector<block*> free_;
+        };
+
+        std::atomic<size_t> refs_;
+        std::array<size_class_state, class_count> classes_;
+        std::mutex slabs_mutex_;
+        std::vector<void*> slabs_;
+
+        message_pool_core() : refs_(1) { }
+
+        ~message_pool_core() {
+            for (auto p : slabs_)
+                ::operator delete(p);
+        }
+
+        // one thread's blocks of one pool
+        struct magazine {
+            message_pool_core* owner_ = nullptr;
+            std::array<std::array<block*, magazine_size>, class_count> blocks_;
+            std::array<size_t, class_count> counts_ = {{ }};
+
+            void flush() {
+                auto owner = owner_;
+                if (!owner)
+                    return;
+                owner_ = nullptr;
+                for (size_t cls = 0; cls != class_count; ++cls) {
+                    owner->drain(cls, blocks_[cls].data(), counts_[cls]);
+                    counts_[cls] = 0;
+                }
+                owner->release_ref();
+            }
+        };
+
+        struct thread_cache {
+            std::array<magazine, cached_pools> magazines_;
+            size_t next_victim_ = 0;
+
+            ~thread_cache() {
+                cache_destroyed() = true;
+                for (auto & m : magazines_)
+                    m.flush();
+            }
+
+            magazine* find(message_pool_core* owner) {
+                for (auto & m : magazines_) {
+                    if (m.owner_ == owner)
+                        return &m;
+                }
+                return nullptr;
+            }
+
+            // the owner's magazine, taking a free one or else flushing the
+            // magazines round robin
+            magazine & bind(message_pool_core* owner) {
+                if (auto m = find(owner))
+                    return *m;
+                auto m = find(nullptr);
+                if (!m) {
+                    m = &magazines_[next_victim_];
+                    next_victim_ = (next_victim_ + 1) % cached_pools;
+                    m->flush();
+                }
+                owner->add_ref();
+                m->owner_ = owner;
+                return *m;
+            }
+        };
+
+        static thread_cache & cache() {
+            static thread_local thread_cache c;
+            return c;
+        }
+
+        // set once the calling thread's cache is destroyed, thread_local
+        // destructors which run later use the central free lists directly
+        static bool & cache_destroyed() {
+            static thread_local bool destroyed = false;
+            return destroyed;
+        }
+
+        // move up to n free blocks to out, carving a new slab when the free
+        // list is empty, returns the number moved
+        size_t refill(size_t cls, block** out, size_t n) {
+            auto & s = classes_[cls];
+            std::lock_guard<std::mutex> l(s.mutex_);
+            if (s.free_.empty())
+                carve(cls, s.free_);
+            n = std::min(n, s.free_.size());
+            std::copy(s.free_.end() - n, s.free_.end(), out);
+            s.free_.resize(s.free_.size() - n);
+            add_ref(n);
+            return n;
+        }
+
+        void drain(size_t cls, block** in, size_t n) {
+            if (!n)
+                return;
+            {
+                auto & s = classes_[cls];
+                std::lock_guard<std::mutex> l(s.mutex_);
+                s.free_.insert(s.free_.end(), in, in + n);
+            }
+            release_ref(n);
+        }
+
+        void carve(size_t cls, std::vector<block*> & free) {
+            auto stride = sizeof(block) + capacity(cls);
+            auto count = std::max<size_t>(1, slab_bytes / stride);
+            auto p = static_cast<char*>(::operator new(stride * count));
+            {
+                std::lock_guard<std::mutex> l(slabs_mutex_);
+                try {
+                    slabs_.push_back(p);
+                } catch (...) {
+                    ::operator delete(p);
+                    throw;
+                }
+            }
+            free.reserve(free.size() + count);
+            for (size_t i = 0; i != count; ++i) {
+                auto b = new (p + i * stride) block;
+                b->owner_ = this;
+                b->size_class_ = cls;
+                free.push_back(b);
+            }
+        }
+    };
+} // namespace detail
+} // namespace azmq
+#endif // AZMQ_DETAIL_MESSAGE_POOL_CORE_HPP_
@@ -0,0 +1,58 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_DETAIL_OP_QUEUE_HPP_
+#define AZMQ_DETAIL_OP_QUEUE_HPP_
+
+#include <cassert>
+
+namespace azmq {
+namespace detail {
+    /** \brief Intrusive FIFO of operations linked through Operation::next_
+     *  \remark The queue does not own the queued operations
+     */
+    template<typename Operation>
+    class op_queue {
+    public:
+        op_queue() = default;
+
+        op_queue(op_queue const&) = delete;
+        op_queue & operator=(op_queue const&) = delete;
+
+        bool empty() const { return front_ == nullptr; }
+
+        Operation* front() const { return front_; }
+
+        void push(Operation* op) {
+            assert((op)&&("null op"));
+            op->next_ = nullptr;
+            if (back_)
+                back_->next_ = op;
+            else
+                front_ = op;
+            back_ = op;
+        }
+
+        Operation* pop() {
+            auto op = front_;
+            if (op) {
+                front_ = op->next_;
+                if (!front_)
+                    back_ = nullptr;
+                op->next_ = nullptr;
+            }
+            return op;
+        }
+
+    private:
+        Operation* front_ = nullptr;
+        Operation* back_ = nullptr;
+    };
+} // namespace detail
+} // namespace azmq
+#endif // AZMQ_DETAIL_OP_QUEUE_HPP_
@@ -11,17 +11,21 @@
 
 #include "../message.hpp"
 #include "socket_ops.hpp"
+#include "socket_stats.hpp"
 
 #include <asio/io_service.hpp>
 
+#include <memory>
+
 namespace azmq {
 namespace detail {
-class reactor_op {
+class reactor_op : public op_stats {
 public:
     using socket_type = socket_ops::socket_type;
     using flags_type = socket_ops::flags_type;
     asio::error_code ec_;
     size_t bytes_transferred_;
+    reactor_op* next_;
 
     bool do_perform(socket_type & socket) { return perform_func_(this, socket); }
     static void do_complete(reactor_op * op) {
@@ -46,12 +50,26 @@ protected:
     reactor_op(perform_func_type perform_func,
                complete_func_type complete_func)
         : bytes_transferred_(0)
+        , next_(nullptr)
         , perform_func_(perform_func)
         , complete_func_(complete_func)
     { }
 
 };
 
+/** \brief Deleter for ops which are dropped before they complete, their
+ *  handler is destroyed without being invoked and their storage released
+ *  through handler_alloc, as it was obtained.
+ */
+struct reactor_op_deleter {
+    using destroy_func_type = void (*)(reactor_op*);
+    destroy_func_type destroy_func_;
+
+    void operator()(reactor_op* op) const { destroy_func_(op); }
+};
+
+using reactor_op_ptr = std::unique_ptr<reactor_op, reactor_op_deleter>;
+
 } // namespace detail
 } // namespace azmq
 #endif // AZMQ_DETAIL_REACTOR_OP_HPP_
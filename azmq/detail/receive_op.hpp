@@ -13,6 +13,8 @@
 #include "../message.hpp"
 #include "socket_ops.hpp"
 #include "reactor_op.hpp"
+#include "handler_alloc.hpp"
+#include "handler_dispatch.hpp"
 
 #include <asio/io_service.hpp>
 
@@ -37,9 +39,14 @@ public:
         auto o = static_cast<receive_buffer_op_base*>(base);
         o->ec_ = asio::error_code();
 
-        o->bytes_transferred_ += socket_ops::receive(o->buffers_, socket, o->flags_ | ZMQ_DONTWAIT, o->ec_);
+        auto sz = socket_ops::receive(o->buffers_, socket, o->flags_ | ZMQ_DONTWAIT, o->ec_);
+        o->bytes_transferred_ += sz;
         if (o->ec_)
             return !o->try_again();
+        auto capacity = asio::buffer_size(o->buffers_);
+        if (sz > capacity)
+            o->count_truncated(sz - capacity);
+        o->count_messages(1);
         return true;
     }
 
@@ -58,8 +65,8 @@ template<typename MutableBufferSequence,
 class receive_buffer_op : public receive_buffer_op_base<MutableBufferSequence> {
 public:
     receive_buffer_op(MutableBufferSequence const& buffers,
-                      Handler handler,
-                      socket_ops::flags_type flags)
+                      socket_ops::flags_type flags,
+                      Handler handler)
         : receive_buffer_op_base<MutableBufferSequence>(buffers, flags,
                                                         &receive_buffer_op::do_complete)
         , handler_(std::move(handler))
@@ -72,8 +79,14 @@ public:
         auto h = std::move(o->handler_);
         auto ec = o->ec_;
         auto bt = o->bytes_transferred_;
-        delete o;
-        h(ec, bt);
+        handler_alloc::destroy(o, h);
+        dispatch_handler(h, ec, bt);
+    }
+
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<receive_buffer_op*>(base);
+        auto h = std::move(o->handler_);
+        handler_alloc::destroy(o, h);
     }
 
 private:
@@ -85,9 +98,10 @@ template<typename MutableBufferSequence,
 class receive_more_buffer_op : public receive_buffer_op_base<MutableBufferSequence> {
 public:
     receive_more_buffer_op(MutableBufferSequence const& buffers,
-                           Handler handler,
-                           socket_ops::flags_type flags)
-        : receive_buffer_op_base<MutableBufferSequence>(buffers, flags,
+                           socket_ops::flags_type flags,
+                           Handler handler)
+        // ZMQ_RCVMORE makes a single buffer receive report remaining parts
+        : receive_buffer_op_base<MutableBufferSequence>(buffers, flags | ZMQ_RCVMORE,
                                                         &receive_more_buffer_op::do_complete)
         , handler_(std::move(handler))
         { }
@@ -100,8 +114,14 @@ public:
         auto ec = o->ec_;
         auto bt = o->bytes_transferred_;
         auto m = o->more();
-        delete o;
-        h(ec, std::make_pair(bt, m));
+        handler_alloc::destroy(o, h);
+        dispatch_handler(h, ec, std::make_pair(bt, m));
+    }
+
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<receive_more_buffer_op*>(base);
+        auto h = std::move(o->handler_);
+        handler_alloc::destroy(o, h);
     }
 
 private:
@@ -123,6 +143,7 @@ public:
         o->bytes_transferred_ = socket_ops::receive(o->msg_, socket, o->flags_ | ZMQ_DONTWAIT, o->ec_);
         if (o->ec_)
             return !o->try_again();
+        o->count_messages(!o->msg_.more());
         return true;
     }
 
@@ -134,8 +155,8 @@ protected:
 template<typename Handler>
 class receive_op : public receive_op_base {
 public:
-    receive_op(Handler handler,
-               socket_ops::flags_type flags)
+    receive_op(socket_ops::flags_type flags,
+               Handler handler)
         : receive_op_base(flags, &receive_op::do_complete)
         , handler_(std::move(handler))
         { }
@@ -148,8 +169,178 @@ public:
         auto m = std::move(o->msg_);
         auto ec = o->ec_;
         auto bt = o->bytes_transferred_;
-        delete o;
-        h(ec, m, bt);
+        handler_alloc::destroy(o, h);
+        dispatch_handler(h, ec, m, bt);
+    }
+
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<receive_op*>(base);
+        auto h = std::move(o->handler_);
+        handler_alloc::destroy(o, h);
+    }
+
+private:
+    Handler handler_;
+};
+
+template<typename Handler>
+class receive_message_op : public receive_op_base {
+public:
+    receive_message_op(socket_ops::flags_type flags,
+                       Handler handler)
+        : receive_op_base(flags, &receive_message_op::do_complete)
+        , handler_(std::move(handler))
+        { }
+
+    static void do_complete(reactor_op* base,
+                            const asio::error_code &,
+                            size_t) {
+        auto o = static_cast<receive_message_op*>(base);
+        auto h = std::move(o->handler_);
+        auto m = std::move(o->msg_);
+        auto ec = o->ec_;
+        handler_alloc::destroy(o, h);
+        dispatch_handler(h, ec, std::move(m));
+    }
+
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<receive_message_op*>(base);
+        auto h = std::move(o->handler_);
+        handler_alloc::destroy(o, h);
+    }
+
+private:
+    Handler handler_;
+};
+
+class receive_batch_op_base : public reactor_op {
+public:
+    receive_batch_op_base(message_vector & msgs,
+                          size_t max_msgs,
+                          socket_ops::flags_type flags,
+                          complete_func_type complete_func)
+        : reactor_op(&receive_batch_op_base::do_perform, complete_func)
+        , msgs_(msgs)
+        , max_msgs_(max_msgs)
+        , flags_(flags)
+        { }
+
+    static bool do_perform(reactor_op* base, socket_type & socket) {
+        auto o = static_cast<receive_batch_op_base*>(base);
+        o->ec_ = asio::error_code();
+
+        auto first = o->msgs_.size();
+        o->bytes_transferred_ += socket_ops::receive_batch(o->msgs_, o->max_msgs_, socket,
+                                                           o->flags_ | ZMQ_DONTWAIT, o->ec_);
+        if (o->ec_)
+            return !o->try_again();
+        if (socket_stats_counter::enabled) {
+            for (auto i = first; i != o->msgs_.size(); ++i)
+                o->count_messages(!o->msgs_[i].more());
+        }
+        return true;
+    }
+
+private:
+    message_vector & msgs_;
+    size_t max_msgs_;
+    flags_type flags_;
+};
+
+template<typename Handler>
+class receive_batch_op : public receive_batch_op_base {
+public:
+    receive_batch_op(message_vector & msgs,
+                     size_t max_msgs,
+                     socket_ops::flags_type flags,
+                     Handler handler)
+        : receive_batch_op_base(msgs, max_msgs, flags, &receive_batch_op::do_complete)
+        , handler_(std::move(handler))
+        { }
+
+    static void do_complete(reactor_op* base,
+                            const asio::error_code &,
+                            size_t) {
+        auto o = static_cast<receive_batch_op*>(base);
+        auto h = std::move(o->handler_);
+        auto ec = o->ec_;
+        auto bt = o->bytes_transferred_;
+        handler_alloc::destroy(o, h);
+        dispatch_handler(h, ec, bt);
+    }
+
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<receive_batch_op*>(base);
+        auto h = std::move(o->handler_);
+        handler_alloc::destroy(o, h);
+    }
+
+private:
+    Handler handler_;
+};
+
+template<typename MessageVector>
+class receive_multipart_op_base : public reactor_op {
+public:
+    receive_multipart_op_base(MessageVector & msgs,
+                              socket_ops::flags_type flags,
+                              complete_func_type complete_func)
+        : reactor_op(&receive_multipart_op_base::do_perform, complete_func)
+        , msgs_(msgs)
+        , flags_(flags)
+        { }
+
+    static bool do_perform(reactor_op* base, socket_type & socket) {
+        auto o = static_cast<receive_multipart_op_base*>(base);
+        o->ec_ = asio::error_code();
+
+        // libzmq delivers the parts of a message atomically, so only the
+        // first part can fail with EAGAIN and the op then simply retries
+        message msg;
+        auto more = false;
+        do {
+            auto sz = socket_ops::receive(msg, socket, o->flags_ | ZMQ_DONTWAIT, o->ec_);
+            if (o->ec_)
+                return !o->try_again();
+            more = msg.more();
+            o->msgs_.emplace_back(std::move(msg));
+            o->bytes_transferred_ += sz;
+        } while (more);
+        o->count_messages(1);
+        return true;
+    }
+
+private:
+    MessageVector & msgs_;
+    flags_type flags_;
+};
+
+template<typename MessageVector,
+         typename Handler>
+class receive_multipart_op : public receive_multipart_op_base<MessageVector> {
+public:
+    receive_multipart_op(MessageVector & msgs,
+                         socket_ops::flags_type flags,
+                         Handler handler)
+        : receive_multipart_op_base<MessageVector>(msgs, flags, &receive_multipart_op::do_complete)
+        , handler_(std::move(handler))
+        { }
+
+    static void do_complete(reactor_op* base,
+                            const asio::error_code &,
+                            size_t) {
+        auto o = static_cast<receive_multipart_op*>(base);
+        auto h = std::move(o->handler_);
+        auto ec = o->ec_;
+        auto bt = o->bytes_transferred_;
+        handler_alloc::destroy(o, h);
+        dispatch_handler(h, ec, bt);
+    }
+
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<receive_multipart_op*>(base);
+        auto h = std::move(o->handler_);
+        handler_alloc::destroy(o, h);
     }
 
 private:
@@ -12,11 +12,23 @@
 #include "../message.hpp"
 #include "socket_ops.hpp"
 #include "reactor_op.hpp"
+#include "handler_alloc.hpp"
+#include "handler_dispatch.hpp"
 
+#include <asio/version.hpp>
 #include <asio/io_service.hpp>
+#include <asio/strand.hpp>
+#include <asio/handler_alloc_hook.hpp>
+#if ASIO_VERSION >= 101100
+#include <asio/associated_allocator.hpp>
+#endif
 
 #include <zmq.h>
+#include <atomic>
 #include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace azmq {
 namespace detail {
@@ -39,11 +51,12 @@ public:
         if (o->ec_) {
             return !o->try_again();
         }
+        o->count_messages(!(o->flags_ & ZMQ_SNDMORE));
         return true;
     }
 
 private:
-    ConstBufferSequence const& buffers_;
+    ConstBufferSequence buffers_;
     flags_type flags_;
 };
 
@@ -52,8 +65,8 @@ template<typename ConstBufferSequence,
 class send_buffer_op : public send_buffer_op_base<ConstBufferSequence> {
 public:
     send_buffer_op(ConstBufferSequence const& buffers,
-                   Handler handler,
-                   reactor_op::flags_type flags)
+                   reactor_op::flags_type flags,
+                   Handler handler)
         : send_buffer_op_base<ConstBufferSequence>(buffers, flags,
                                                    &send_buffer_op::do_complete)
         , handler_(std::move(handler))
@@ -66,9 +79,15 @@ public:
         auto h = std::move(o->handler_);
         auto ec = o->ec_;
         auto bt = o->bytes_transferred_;
-        delete o;
+        handler_alloc::destroy(o, h);
 
-        h(ec, bt);
+        dispatch_handler(h, ec, bt);
+    }
+
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<send_buffer_op*>(base);
+        auto h = std::move(o->handler_);
+        handler_alloc::destroy(o, h);
     }
 
 private:
@@ -92,6 +111,7 @@ public:
 
         if (o->ec_)
             return !o->try_again(); // some other error
+        o->count_messages(!(o->flags_ & ZMQ_SNDMORE));
         return true;
     };
 
@@ -104,8 +124,8 @@ template<typename Handler>
 class send_op : public send_op_base {
 public:
     send_op(message msg,
-            Handler handler,
-            flags_type flags)
+            flags_type flags,
+            Handler handler)
         : send_op_base(std::move(msg), flags, &send_op::do_complete)
         , handler_(std::move(handler))
     { }
@@ -117,8 +137,370 @@ public:
         auto h = std::move(o->handler_);
         auto ec = o->ec_;
         auto bt = o->bytes_transferred_;
-        delete o;
-        h(ec, bt);
+        handler_alloc::destroy(o, h);
+        dispatch_handler(h, ec, bt);
+    }
+
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<send_op*>(base);
+        auto h = std::move(o->handler_);
+        handler_alloc::destroy(o, h);
+    }
+
+private:
+    Handler handler_;
+};
+
+// completes once libzmq has released every frame, which may happen on a
+// libzmq I/O thread after the socket, and its strand object, are gone.
+// Until then the op holds work on the io_service and its own copy of the
+// socket's strand handle, if it has one. The completion is posted through
+// that strand and allocated as the handler's own operations are.
+template<typename ConstBufferSequence,
+         typename Handler>
+class send_nocopy_buffer_op : public reactor_op {
+public:
+    send_nocopy_buffer_op(ConstBufferSequence const& buffers,
+                          flags_type flags,
+                          asio::io_service & ios,
+                          asio::io_service::strand const* strand,
+                          Handler handler)
+        : reactor_op(&send_nocopy_buffer_op::do_perform, &send_nocopy_buffer_op::do_complete)
+        , buffers_(buffers)
+        , flags_(flags)
+        , work_(ios)
+        , has_strand_(strand != nullptr)
+        , refs_(1)
+        , handler_(std::move(handler))
+    {
+        if (has_strand_)
+            new (&strand_) asio::io_service::strand(*strand);
+    }
+
+    ~send_nocopy_buffer_op() {
+        if (has_strand_)
+            get_strand().~strand();
+    }
+
+    static bool do_perform(reactor_op* base, socket_type & socket) {
+        auto o = static_cast<send_nocopy_buffer_op*>(base);
+        o->ec_ = asio::error_code();
+        o->bytes_transferred_ += socket_ops::send(o->buffers_, socket, o->flags_ | ZMQ_DONTWAIT,
+            [o](asio::const_buffer const& b) {
+                // each frame holds a reference on the op until libzmq releases it
+                ++o->refs_;
+                return message(nocopy,
+                               asio::mutable_buffer(const_cast<void*>(asio::buffer_cast<const void*>(b)),
+                                                    asio::buffer_size(b)),
+                               o, &send_nocopy_buffer_op::release_frame);
+            }, o->ec_);
+        if (o->ec_) {
+            return !o->try_again();
+        }
+        o->count_messages(!(o->flags_ & ZMQ_SNDMORE));
+        return true;
+    }
+
+    static void do_complete(reactor_op* base,
+                            const asio::error_code &,
+                            size_t) {
+        auto o = static_cast<send_nocopy_buffer_op*>(base);
+        if (--o->refs_ == 0)
+            complete(o);
+    }
+
+    // drops the op's own reference, frames libzmq still holds keep it alive
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<send_nocopy_buffer_op*>(base);
+        if (--o->refs_ == 0) {
+            auto h = std::move(o->handler_);
+            handler_alloc::destroy(o, h);
+        }
+    }
+
+private:
+    ConstBufferSequence buffers_;
+    flags_type flags_;
+    asio::io_service::work work_;
+    typename std::aligned_storage<sizeof(asio::io_service::strand),
+                                  alignof(asio::io_service::strand)>::type strand_;
+    bool has_strand_;
+    std::atomic<size_t> refs_;
+    Handler handler_;
+
+    struct frame_completion {
+        send_nocopy_buffer_op* o_;
+
+        void operator()() { complete(o_); }
+
+#if ASIO_VERSION >= 101100
+        using allocator_type = typename asio::associated_allocator<Handler>::type;
+
+        allocator_type get_allocator() const noexcept {
+            return asio::get_associated_allocator(o_->handler_);
+        }
+#endif
+
+        friend
+        void* asio_handler_allocate(size_t size, frame_completion* h) {
+            using asio::asio_handler_allocate;
+            return asio_handler_allocate(size, std::addressof(h->o_->handler_));
+        }
+
+        friend
+        void asio_handler_deallocate(void* p, size_t size, frame_completion* h) {
+            using asio::asio_handler_deallocate;
+            asio_handler_deallocate(p, size, std::addressof(h->o_->handler_));
+        }
+    };
+
+    asio::io_service::strand & get_strand() {
+        return *reinterpret_cast<asio::io_service::strand*>(&strand_);
+    }
+
+    // may be called from a libzmq thread
+    static void release_frame(void*, void* hint) {
+        auto o = static_cast<send_nocopy_buffer_op*>(hint);
+        if (--o->refs_ == 0) {
+            if (o->has_strand_)
+                o->get_strand().post(frame_completion{ o });
+            else
+                o->work_.get_io_service().post(frame_completion{ o });
+        }
+    }
+
+    static void complete(send_nocopy_buffer_op* o) {
+        auto h = std::move(o->handler_);
+        auto ec = o->ec_;
+        auto bt = o->bytes_transferred_;
+        handler_alloc::destroy(o, h);
+        dispatch_handler(h, ec, bt);
+    }
+};
+
+// libzmq frees the op from its own threads, possibly after the io_service
+// and so the socket_service's allocator are gone
+template<typename ConstBufferSequence, typename Handler>
+struct completes_in_reactor<send_nocopy_buffer_op<ConstBufferSequence, Handler>> : std::false_type { };
+
+template<typename MessageRange>
+class send_batch_op_base : public reactor_op {
+public:
+    send_batch_op_base(MessageRange msgs,
+                       flags_type flags,
+                       complete_func_type complete_func)
+        : reactor_op(&send_batch_op_base::do_perform, complete_func)
+        , msgs_(std::move(msgs))
+        , it_(std::begin(msgs_))
+        , msgs_sent_(0)
+        , flags_(flags)
+        { }
+
+    static bool do_perform(reactor_op* base, socket_type & socket) {
+        auto o = static_cast<send_batch_op_base*>(base);
+        o->ec_ = asio::error_code();
+
+        // resumes from the first message not yet accepted by the socket
+        for (; o->it_ != std::end(o->msgs_); ++o->it_) {
+            auto sz = socket_ops::send(*o->it_, socket, o->flags_ | ZMQ_DONTWAIT, o->ec_);
+            if (o->ec_)
+                return !o->try_again();
+            o->bytes_transferred_ += sz;
+            o->count_messages(!(o->flags_ & ZMQ_SNDMORE));
+            ++o->msgs_sent_;
+        }
+        return true;
+    }
+
+protected:
+    size_t msgs_sent() const { return msgs_sent_; }
+
+private:
+    MessageRange msgs_;
+    decltype(std::begin(std::declval<MessageRange&>())) it_;
+    size_t msgs_sent_;
+    flags_type flags_;
+};
+
+template<typename MessageRange,
+         typename Handler>
+class send_batch_op : public send_batch_op_base<MessageRange> {
+public:
+    send_batch_op(MessageRange msgs,
+                  reactor_op::flags_type flags,
+                  Handler handler)
+        : send_batch_op_base<MessageRange>(std::move(msgs), flags,
+                                           &send_batch_op::do_complete)
+        , handler_(std::move(handler))
+    { }
+
+    static void do_complete(reactor_op* base,
+                            const asio::error_code &,
+                            size_t) {
+        auto o = static_cast<send_batch_op*>(base);
+        auto h = std::move(o->handler_);
+        auto ec = o->ec_;
+        auto ct = o->msgs_sent();
+        auto bt = o->bytes_transferred_;
+        handler_alloc::destroy(o, h);
+        dispatch_handler(h, ec, ct, bt);
+    }
+
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<send_batch_op*>(base);
+        auto h = std::move(o->handler_);
+        handler_alloc::destroy(o, h);
+    }
+
+private:
+    Handler handler_;
+};
+
+// sends the parts of one multipart message, which the op owns. The parts
+// are handed to libzmq as they are, and after an EAGAIN part way through
+// sending resumes with the next unsent part.
+template<typename MessageVector>
+class send_multipart_op_base : public reactor_op {
+public:
+    send_multipart_op_base(MessageVector parts,
+                           flags_type flags,
+                           complete_func_type complete_func)
+        : reactor_op(&send_multipart_op_base::do_perform, complete_func)
+        , parts_(std::move(parts))
+        , next_part_(0)
+        , flags_(flags)
+        { }
+
+    static bool do_perform(reactor_op* base, socket_type & socket) {
+        auto o = static_cast<send_multipart_op_base*>(base);
+        o->ec_ = asio::error_code();
+
+        auto n = o->parts_.size();
+        for (; o->next_part_ < n; ++o->next_part_) {
+            auto f = o->next_part_ + 1 == n ? o->flags_
+                                            : o->flags_ | ZMQ_SNDMORE;
+            auto sz = socket_ops::send(o->parts_[o->next_part_], socket, f | ZMQ_DONTWAIT, o->ec_);
+            if (o->ec_)
+                return !o->try_again();
+            o->bytes_transferred_ += sz;
+        }
+        o->count_messages(!(o->flags_ & ZMQ_SNDMORE));
+        return true;
+    }
+
+private:
+    MessageVector parts_;
+    size_t next_part_;
+    flags_type flags_;
+};
+
+template<typename MessageVector,
+         typename Handler>
+class send_multipart_op : public send_multipart_op_base<MessageVector> {
+public:
+    send_multipart_op(MessageVector parts,
+                      reactor_op::flags_type flags,
+                      Handler handler)
+        : send_multipart_op_base<MessageVector>(std::move(parts), flags,
+                                                &send_multipart_op::do_complete)
+        , handler_(std::move(handler))
+    { }
+
+    static void do_complete(reactor_op* base,
+                            const asio::error_code &,
+                            size_t) {
+        auto o = static_cast<send_multipart_op*>(base);
+        auto h = std::move(o->handler_);
+        auto ec = o->ec_;
+        auto bt = o->bytes_transferred_;
+        handler_alloc::destroy(o, h);
+        dispatch_handler(h, ec, bt);
+    }
+
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<send_multipart_op*>(base);
+        auto h = std::move(o->handler_);
+        handler_alloc::destroy(o, h);
+    }
+
+private:
+    Handler handler_;
+};
+
+// sends a sequence of whole messages as received, each part keeping the
+// ZMQ_SNDMORE state of its more() flag, resuming with the next unsent part
+// after an EAGAIN
+template<typename MessageVector>
+class send_frames_op_base : public reactor_op {
+public:
+    send_frames_op_base(MessageVector frames,
+                        flags_type flags,
+                        complete_func_type complete_func)
+        : reactor_op(&send_frames_op_base::do_perform, complete_func)
+        , frames_(std::move(frames))
+        , next_part_(0)
+        , flags_(flags)
+        { }
+
+    static bool do_perform(reactor_op* base, socket_type & socket) {
+        auto o = static_cast<send_frames_op_base*>(base);
+        o->ec_ = asio::error_code();
+
+        auto n = o->frames_.size();
+        for (; o->next_part_ < n; ++o->next_part_) {
+            auto & f = o->frames_[o->next_part_];
+            auto flags = f.more() ? o->flags_ | ZMQ_SNDMORE
+                                  : o->flags_;
+            auto sz = socket_ops::send(f, socket, flags | ZMQ_DONTWAIT, o->ec_);
+            if (o->ec_)
+                return !o->try_again();
+            o->bytes_transferred_ += sz;
+            o->count_messages(!f.more());
+        }
+        return true;
+    }
+
+protected:
+    // the frames, sent and so emptied, are handed back for reuse
+    MessageVector take_frames() {
+        frames_.clear();
+        return std::move(frames_);
+    }
+
+private:
+    MessageVector frames_;
+    size_t next_part_;
+    flags_type flags_;
+};
+
+template<typename MessageVector,
+         typename Handler>
+class send_frames_op : public send_frames_op_base<MessageVector> {
+public:
+    send_frames_op(MessageVector frames,
+                   reactor_op::flags_type flags,
+                   Handler handler)
+        : send_frames_op_base<MessageVector>(std::move(frames), flags,
+                                             &send_frames_op::do_complete)
+        , handler_(std::move(handler))
+    { }
+
+    static void do_complete(reactor_op* base,
+                            const asio::error_code &,
+                            size_t) {
+        auto o = static_cast<send_frames_op*>(base);
+        auto h = std::move(o->handler_);
+        auto ec = o->ec_;
+        auto bt = o->bytes_transferred_;
+        auto frames = o->take_frames();
+        handler_alloc::destroy(o, h);
+        dispatch_handler(h, ec, bt, frames);
+    }
+
+    static void do_destroy(reactor_op* base) {
+        auto o = static_cast<send_frames_op*>(base);
+        auto h = std::move(o->handler_);
+        handler_alloc::destroy(o, h);
     }
 
 private:
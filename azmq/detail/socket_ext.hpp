@@ -55,7 +55,8 @@ namespace detail {
         template<typename Option>
         asio::error_code get_option(Option & opt, asio::error_code & ec) const {
             assert((ptr_)&&("reusing (re)moved instance of socket_ext"));
-            return ptr_->set_option(opt_model<Option>(opt), ec);
+            opt_model<Option> m(opt);
+            return ptr_->get_option(m, ec);
         }
 
     private :
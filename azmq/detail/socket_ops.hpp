@@ -50,6 +50,22 @@ namespace detail {
         static bool const value = sizeof(Test<T>(0)) == sizeof(Yes);
     };
     
+    // true for containers of message, which are sent part by part without
+    // copying the payloads
+    template<typename T, typename = void>
+    struct is_message_range : std::false_type { };
+
+    template<typename T>
+    struct is_message_range<T, typename std::enable_if<has_begin<T>::value>::type>
+        : std::is_same<typename std::decay<decltype(*std::declval<T const>().begin())>::type, message> { };
+
+    // parts of a multipart message owned by the caller, which are handed to
+    // libzmq as they are rather than copied
+    template<typename MessageVector>
+    struct message_parts {
+        MessageVector & parts;
+    };
+
     struct socket_ops {
         using endpoint_type = std::string;
 
@@ -133,8 +149,16 @@ namespace detail {
                                               endpoint_type & ep,
                                               asio::error_code & ec) {
             assert((socket)&&("invalid socket"));
-            const std::regex simple_tcp("^tcp://.*:(\\d+)$");
-            const std::regex dynamic_tcp("^(tcp://.*):([*!])(\\[(\\d+)?-(\\d+)?\\])?$");
+            // only tcp endpoints need parsing, everything else (notably the
+            // inproc pipe bound for every actor) goes straight to zmq_bind
+            if (ep.compare(0, 6, "tcp://") != 0) {
+                if (zmq_bind(socket.get(), ep.c_str()) < 0)
+                    ec = make_error_code();
+                return ec;
+            }
+
+            static const std::regex simple_tcp("^tcp://.*:(\\d+)$");
+            static const std::regex dynamic_tcp("^(tcp://.*):([*!])(\\[(\\d+)?-(\\d+)?\\])?$");
             std::smatch mres;
             int rc = -1;
             if (std::regex_match(ep, mres, simple_tcp)) {
@@ -273,23 +297,98 @@ namespace detail {
                 ec = make_error_code();
                 return 0;
             }
+            const_cast<message&>(msg).sent();
+            return rc;
+        }
+
+        /** \brief send a single frame straight from buffer with zmq_send,
+         *  small frames are stored inline without allocating
+         */
+        static size_t send(asio::const_buffer const& buffer,
+                           socket_type & socket,
+                           flags_type flags,
+                           asio::error_code & ec) {
+            assert((socket)&&("Invalid socket"));
+            auto rc = zmq_send(socket.get(), asio::buffer_cast<void const*>(buffer),
+                               asio::buffer_size(buffer), flags);
+            if (rc < 0) {
+                ec = make_error_code();
+                return 0;
+            }
             return rc;
         }
 
+        template<typename ConstBufferSequence,
+                 typename MessageFactory>
+        static size_t send(ConstBufferSequence const& buffers,
+                           socket_type & socket,
+                           flags_type flags,
+                           MessageFactory make_message,
+                           asio::error_code & ec) {
+            size_t res = 0;
+            auto last = std::distance(std::begin(buffers), std::end(buffers)) - 1;
+            auto index = 0u;
+            for (auto it = std::begin(buffers); it != std::end(buffers); ++it, ++index) {
+                auto f = index == last ? flags
+                                       : flags | ZMQ_SNDMORE;
+                res += send(make_message(*it), socket, f, ec);
+                if (ec) return 0u;
+            }
+            return res;
+        }
+
         template<typename ConstBufferSequence>
         static auto send(ConstBufferSequence const& buffers,
                          socket_type & socket,
                          flags_type flags,
                          asio::error_code & ec) ->
+            typename std::enable_if<has_begin<ConstBufferSequence>::value &&
+                                    !is_message_range<ConstBufferSequence>::value, size_t>::type
+        {
+            return send(buffers, socket, flags, [](asio::const_buffer const& b) {
+                return message(b);
+            }, ec);
+        }
+
+        /** \brief send each message of msgs as a part of one multipart
+         *  message, each part shares its payload with the original
+         */
+        template<typename MessageRange>
+        static auto send(MessageRange const& msgs,
+                         socket_type & socket,
+                         flags_type flags,
+                         asio::error_code & ec) ->
+            typename std::enable_if<is_message_range<MessageRange>::value, size_t>::type
+        {
+            return send(msgs, socket, flags, [](message const& m) {
+                return m;
+            }, ec);
+        }
+
+        template<typename ConstBufferSequence>
+        static auto send(nocopy_t,
+                         ConstBufferSequence const& buffers,
+                         socket_type & socket,
+                         flags_type flags,
+                         asio::error_code & ec) ->
             typename std::enable_if<has_begin<ConstBufferSequence>::value, size_t>::type
         {
+            return send(buffers, socket, flags, [](asio::const_buffer const& b) {
+                return message(nocopy, b);
+            }, ec);
+        }
+
+        template<typename MessageVector>
+        static size_t send(message_parts<MessageVector> const& p,
+                           socket_type & socket,
+                           flags_type flags,
+                           asio::error_code & ec) {
             size_t res = 0;
-            auto last = std::distance(std::begin(buffers), std::end(buffers)) - 1;
-            auto index = 0u;
-            for (auto it = std::begin(buffers); it != std::end(buffers); ++it, ++index) {
-                auto f = index == last ? flags
-                                       : flags | ZMQ_SNDMORE;
-                res += send(message(*it), socket, f, ec);
+            auto n = p.parts.size();
+            for (size_t i = 0; i != n; ++i) {
+                auto f = i + 1 == n ? flags
+                                    : flags | ZMQ_SNDMORE;
+                res += send(p.parts[i], socket, f, ec);
                 if (ec) return 0u;
             }
             return res;
@@ -301,6 +400,25 @@ namespace detail {
                               asio::error_code & ec) {
             assert((socket)&&("Invalid socket"));
             auto rc = zmq_msg_recv(const_cast<zmq_msg_t*>(&msg.msg_), socket.get(), flags);
+            msg.received();
+            if (rc < 0) {
+                ec = make_error_code();
+                return 0;
+            }
+            return rc;
+        }
+
+        /** \brief receive a frame straight into buffer with zmq_recv
+         *  \returns the full size of the frame, which is larger than the
+         *  buffer if the frame was truncated
+         */
+        static size_t receive(asio::mutable_buffer const& buffer,
+                              socket_type & socket,
+                              flags_type flags,
+                              asio::error_code & ec) {
+            assert((socket)&&("Invalid socket"));
+            auto rc = zmq_recv(socket.get(), asio::buffer_cast<void*>(buffer),
+                               asio::buffer_size(buffer), flags);
             if (rc < 0) {
                 ec = make_error_code();
                 return 0;
@@ -315,9 +433,18 @@ namespace detail {
                             asio::error_code & ec) ->
             typename std::enable_if<has_begin<MutableBufferSequence>::value, size_t>::type
         {
+            auto it = std::begin(buffers);
+            if (it != std::end(buffers) && std::next(it) == std::end(buffers)) {
+                auto res = receive(asio::mutable_buffer(*it), socket, flags, ec);
+                // reporting further parts costs a getsockopt, only pay for
+                // it when the caller asked for multipart semantics
+                if (!ec && (flags & ZMQ_RCVMORE) == ZMQ_RCVMORE && get_socket_rcvmore(socket))
+                    ec = make_error_code(std::errc::no_buffer_space);
+                return res;
+            }
+
             size_t res = 0;
             message msg;
-            auto it = std::begin(buffers);
             do {
                 auto sz = receive(msg, socket, flags, ec);
                 if (ec)
@@ -337,7 +464,8 @@ namespace detail {
             return res;
         }
 
-        static size_t receive_more(message_vector & vec,
+        template<typename MessageVector>
+        static size_t receive_more(MessageVector & vec,
                                    socket_type & socket,
                                    flags_type flags,
                                    asio::error_code & ec) {
@@ -356,6 +484,35 @@ namespace detail {
             return res;
         }
 
+        static size_t receive_batch(message_vector & vec,
+                                    size_t max_msgs,
+                                    socket_type & socket,
+                                    flags_type flags,
+                                    asio::error_code & ec) {
+            size_t res = 0;
+            size_t ct = 0;
+            bool more = false;
+            message msg;
+            while (more || ct < max_msgs) {
+                auto sz = receive(msg, socket, flags, ec);
+                if (ec) {
+                    // a partial batch is a success, parts of a multipart
+                    // message are always available once the first part is
+                    if (ct && !more &&
+                            ec.value() == (int)std::errc::resource_unavailable_try_again)
+                        ec = asio::error_code();
+                    return res;
+                }
+                more = msg.more();
+                if (!more)
+                    ++ct;
+                vec.emplace_back(std::move(msg));
+                res += sz;
+                flags |= ZMQ_DONTWAIT;
+            }
+            return res;
+        }
+
         static size_t flush(socket_type & socket,
                             asio::error_code & ec) {
             size_t res = 0;
@@ -21,18 +21,29 @@
 #include "socket_ops.hpp"
 #include "socket_ext.hpp"
 #include "reactor_op.hpp"
+#include "op_queue.hpp"
+#include "handler_alloc.hpp"
+#include "socket_stats.hpp"
 #include "send_op.hpp"
 #include "receive_op.hpp"
 
 #include <cassert>
-#include <list>
 #include <asio/system_error.hpp>
+#include <asio/strand.hpp>
 #include <map>
 #include <mutex>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include <memory>
+#include <new>
 #include <typeindex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <tuple>
 #include <ostream>
@@ -49,9 +60,13 @@ namespace detail {
         using flags_type = socket_ops::flags_type;
         using more_result_type = socket_ops::more_result_type;
         using context_type = context_ops::context_type;
-        using op_queue_type = std::list<std::reference_wrapper<reactor_op>>;
+        using op_queue_type = op_queue<reactor_op>;
         using exts_type = std::map<std::type_index, socket_ext>;
         using allow_speculative = opt::boolean<static_cast<int>(opt::limits::lib_socket_min)>;
+        using sticky_registration = opt::integer<static_cast<int>(opt::limits::lib_socket_min) + 1>;
+        using stats = opt::base<socket_stats, static_cast<int>(opt::limits::lib_socket_min) + 2>;
+        using latency = opt::base<socket_latency, static_cast<int>(opt::limits::lib_socket_min) + 3>;
+        using track_latency = opt::boolean<static_cast<int>(opt::limits::lib_socket_min) + 4>;
 
         enum class shutdown_type {
             none = 0,
@@ -67,6 +82,8 @@ namespace detail {
 
         struct per_descriptor_data {
             bool optimize_single_threaded_ = false;
+            // the socket's own copy of the strand handle it was opened on
+            std::unique_ptr<asio::io_service::strand> strand_;
             socket_type socket_;
             stream_descriptor sd_;
             mutable std::mutex mutex_;
@@ -74,11 +91,32 @@ namespace detail {
             bool scheduled_ = false;
             bool missed_events_found_ = false;
             bool allow_speculative_ = true;
+            std::chrono::milliseconds sticky_period_{ 0 };
+            std::chrono::steady_clock::time_point last_active_;
             shutdown_type shutdown_ = shutdown_type::none;
             exts_type exts_;
             endpoint_type endpoint_;
             bool serverish_ = false;
             std::array<op_queue_type, max_ops> op_queue_;
+            socket_stats_counter stats_;
+            // receives what completion handlers run from the reactor or a
+            // posted completion throw, instead of io_service::run()
+            std::function<void(std::exception_ptr)> handler_error_;
+
+            void complete(op_queue_type & ops) {
+                while (auto op = ops.pop())
+                    complete(op);
+            }
+
+            void complete(reactor_op* op) {
+                if (!handler_error_)
+                    return reactor_op::do_complete(op);
+                try {
+                    reactor_op::do_complete(op);
+                } catch (...) {
+                    handler_error_(std::current_exception());
+                }
+            }
 
             void do_open(asio::io_service & ios,
                          context_type & ctx,
@@ -95,6 +133,26 @@ namespace detail {
                 optimize_single_threaded_ = optimize_single_threaded;
             }
 
+            // internal completions are serialised through strand_ if the
+            // socket was opened on one
+            template<typename Handler>
+            void post(Handler && handler) {
+                if (strand_)
+                    strand_->post(std::forward<Handler>(handler));
+                else
+                    sd_->get_io_service().post(std::forward<Handler>(handler));
+            }
+
+            template<typename Handler>
+            void async_wait(Handler && handler) {
+                if (strand_)
+                    sd_->async_read_some(asio::null_buffers(),
+                                         strand_->wrap(std::forward<Handler>(handler)));
+                else
+                    sd_->async_read_some(asio::null_buffers(),
+                                         std::forward<Handler>(handler));
+            }
+
             int events_mask() const
             {
                 static_assert(2 == max_ops, "2 == max_ops");
@@ -108,10 +166,17 @@ namespace detail {
                     const int filter[max_ops] = { ZMQ_POLLIN, ZMQ_POLLOUT };
 
                     for (size_t i = 0; i != max_ops; ++i) {
-                        if ((evs & filter[i]) && op_queue_[i].front().get().do_perform(socket_)) {
-                            auto op = op_queue_[i].front();
-                            op_queue_[i].pop_front();
-                            ops.push_back(op);
+                        if (!(evs & filter[i]))
+                            continue;
+                        if (op_queue_[i].front()->do_perform(socket_)) {
+                            auto op = op_queue_[i].pop();
+                            stats_.dequeued(i);
+                            stats_.completed(i, false, *op);
+                            if (!op->ec_)
+                                stats_.completed(i, op->bytes_transferred_ - op->truncated(), op->messages());
+                            ops.push(op);
+                        } else {
+                            stats_.would_block();
                         }
                     }
                 }
@@ -119,17 +184,30 @@ namespace detail {
                 return 0 != events_mask(); // true if more operations scheduled
             }
 
+            // true if the reactor wait should stay armed although no ops are
+            // pending, performed is true if the current wakeup completed ops.
+            // Only evaluated on a wakeup, an expired period is noticed at the
+            // next one, not when it runs out.
+            bool keep_armed(bool performed) {
+                if (sticky_period_ == std::chrono::milliseconds::zero())
+                    return false;
+                auto now = std::chrono::steady_clock::now();
+                if (performed)
+                    last_active_ = now;
+                return now - last_active_ < sticky_period_;
+            }
+
             asio::error_code cancel_stream_descriptor(asio::error_code & ec) {
                 return socket_ops::cancel_stream_descriptor(sd_, ec);
             }
 
             void cancel_ops(asio::error_code const& ec, op_queue_type & ops) {
                 for (size_t i = 0; i != max_ops; ++i) {
-                    while (!op_queue_[i].empty()) {
-                        op_queue_[i].front().get().ec_ = ec;
-                        auto op = op_queue_[i].front();
-                        op_queue_[i].pop_front();
-                        ops.push_back(op);
+                    while (auto op = op_queue_[i].pop()) {
+                        stats_.dequeued(i);
+                        stats_.canceled();
+                        op->ec_ = ec;
+                        ops.push(op);
                     }
                 }
             }
@@ -161,18 +239,22 @@ namespace detail {
                 stm << "}";
             }
 
+            bool is_serialized() const {
+                return optimize_single_threaded_ || strand_;
+            }
+
             void lock() const {
-                if (optimize_single_threaded_) return;
+                if (is_serialized()) return;
                 mutex_.lock();
             }
 
             void try_lock() const {
-                if (optimize_single_threaded_) return;
+                if (is_serialized()) return;
                 mutex_.try_lock();
             }
 
             void unlock() const {
-                if (optimize_single_threaded_) return;
+                if (is_serialized()) return;
                 mutex_.unlock();
             }
         };
@@ -219,6 +301,21 @@ namespace detail {
             return ec;
         }
 
+        asio::error_code do_open(implementation_type & impl,
+                                 int type,
+                                 asio::io_service::strand & strand,
+                                 asio::error_code & ec) {
+            if (!do_open(impl, type, false, ec))
+                impl->strand_.reset(new asio::io_service::strand(strand));
+            return ec;
+        }
+
+        /** \brief the strand the socket was opened on, nullptr if none */
+        asio::io_service::strand * get_strand(implementation_type & impl) const {
+            assert((impl)&&("impl"));
+            return impl->strand_.get();
+        }
+
         void destroy(implementation_type & impl) {
             impl.reset();
         }
@@ -278,12 +375,26 @@ namespace detail {
                     impl->allow_speculative_ = option.data() ? *static_cast<bool const*>(option.data())
                                                              : false;
                 break;
+            case sticky_registration::static_name::value :
+                    if (option.size() < sizeof(int)) {
+                        ec = make_error_code(std::errc::invalid_argument);
+                    } else {
+                        ec = asio::error_code();
+                        impl->sticky_period_ = std::chrono::milliseconds(*static_cast<int const*>(option.data()));
+                    }
+                break;
+            case track_latency::static_name::value :
+                    impl->stats_.track_latency(option.data() ? *static_cast<bool const*>(option.data())
+                                                             : false, ec);
+                break;
             default:
+                // an extension which does not know the option reports
+                // not_supported, anything else means it handled it
                 for (auto& ext : impl->exts_) {
-                    if (ext.second.set_option(option, ec)) {
-                        if (ec == std::errc::not_supported) continue;
+                    ec = asio::error_code();
+                    ext.second.set_option(option, ec);
+                    if (ec != std::errc::not_supported)
                         return ec;
-                    }
                 }
                 ec = asio::error_code();
                 socket_ops::set_option(impl->socket_, option, ec);
@@ -305,12 +416,38 @@ namespace detail {
                         *static_cast<bool*>(option.data()) = impl->allow_speculative_;
                     }
                 break;
+            case sticky_registration::static_name::value :
+                    if (option.size() < sizeof(int)) {
+                        ec = make_error_code(std::errc::invalid_argument);
+                    } else {
+                        ec = asio::error_code();
+                        *static_cast<int*>(option.data()) = static_cast<int>(impl->sticky_period_.count());
+                    }
+                break;
+            case track_latency::static_name::value :
+                    if (!socket_stats_counter::enabled) {
+                        ec = make_error_code(std::errc::not_supported);
+                    } else if (option.size() < sizeof(bool)) {
+                        ec = make_error_code(std::errc::invalid_argument);
+                    } else {
+                        ec = asio::error_code();
+                        *static_cast<bool*>(option.data()) = impl->stats_.tracking_latency();
+                    }
+                break;
+            case stats::static_name::value :
+                    impl->stats_.get(option.data(), option.size(), ec);
+                break;
+            case latency::static_name::value :
+                    impl->stats_.get_latency(option.data(), option.size(), ec);
+                break;
             default:
+                // an extension which does not know the option reports
+                // not_supported, anything else means it handled it
                 for (auto& ext : impl->exts_) {
-                    if (ext.second.get_option(option, ec)) {
-                        if (ec == std::errc::not_supported) continue;
+                    ec = asio::error_code();
+                    ext.second.get_option(option, ec);
+                    if (ec != std::errc::not_supported)
                         return ec;
-                    }
                 }
                 ec = asio::error_code();
                 socket_ops::get_option(impl->socket_, option, ec);
@@ -384,6 +521,24 @@ namespace detail {
             if (is_shutdown(impl, op_type::write_op, ec))
                 return 0;
             auto r = socket_ops::send(buffers, impl->socket_, flags, ec);
+            if (!ec)
+                impl->stats_.completed(op_type::write_op, r, !(flags & ZMQ_SNDMORE));
+            check_missed_events(impl);
+            return r;
+        }
+
+        template<typename ConstBufferSequence>
+        size_t send(implementation_type & impl,
+                    nocopy_t,
+                    ConstBufferSequence const& buffers,
+                    flags_type flags,
+                    asio::error_code & ec) {
+            unique_lock l{ *impl };
+            if (is_shutdown(impl, op_type::write_op, ec))
+                return 0;
+            auto r = socket_ops::send(nocopy, buffers, impl->socket_, flags, ec);
+            if (!ec)
+                impl->stats_.completed(op_type::write_op, r, !(flags & ZMQ_SNDMORE));
             check_missed_events(impl);
             return r;
         }
@@ -396,6 +551,8 @@ namespace detail {
             if (is_shutdown(impl, op_type::write_op, ec))
                 return 0;
             auto r = socket_ops::send(msg, impl->socket_, flags, ec);
+            if (!ec)
+                impl->stats_.completed(op_type::write_op, r, !(flags & ZMQ_SNDMORE));
             check_missed_events(impl);
             return r;
         }
@@ -409,6 +566,10 @@ namespace detail {
             if (is_shutdown(impl, op_type::read_op, ec))
                 return 0;
             auto r = socket_ops::receive(buffers, impl->socket_, flags, ec);
+            // r is the size of the part, count only what reached the buffers
+            if (!ec)
+                impl->stats_.completed(op_type::read_op,
+                                       std::min(r, asio::buffer_size(buffers)), 1);
             check_missed_events(impl);
             return r;
         }
@@ -421,18 +582,23 @@ namespace detail {
             if (is_shutdown(impl, op_type::read_op, ec))
                 return 0;
             auto r = socket_ops::receive(msg, impl->socket_, flags, ec);
+            if (!ec)
+                impl->stats_.completed(op_type::read_op, r, !msg.more());
             check_missed_events(impl);
             return r;
         }
 
+        template<typename MessageVector>
         size_t receive_more(implementation_type & impl,
-                            message_vector & vec,
+                            MessageVector & vec,
                             flags_type flags,
                             asio::error_code & ec) {
             unique_lock l{ *impl };
             if (is_shutdown(impl, op_type::read_op, ec))
                 return 0;
             auto r = socket_ops::receive_more(vec, impl->socket_, flags, ec);
+            if (!ec)
+                impl->stats_.completed(op_type::read_op, r, 1);
             check_missed_events(impl);
             return r;
         }
@@ -447,10 +613,16 @@ namespace detail {
             return r;
         }
 
-        using reactor_op_ptr = std::unique_ptr<reactor_op>;
-        template<typename T, typename... Args>
-        void enqueue(implementation_type & impl, op_type o, Args&&... args) {
-            reactor_op_ptr p{ new T(std::forward<Args>(args)...) };
+        template<typename T, typename Handler, typename... Args>
+        void enqueue(implementation_type & impl, op_type o, Handler && handler, Args&&... args) {
+            auto v = handler_alloc::allocate_op<T>(handler, alloc_);
+            reactor_op_ptr p(nullptr, reactor_op_deleter{ &T::do_destroy });
+            try {
+                p.reset(new (v) T(std::forward<Args>(args)..., std::forward<Handler>(handler)));
+            } catch (...) {
+                handler_alloc::deallocate(v, sizeof(T), handler);
+                throw;
+            }
             asio::error_code ec = enqueue(impl, o, p);
             if (ec) {
                 assert((p)&&("op ptr"));
@@ -459,6 +631,17 @@ namespace detail {
             }
         }
 
+        /** \brief pass exceptions thrown by the socket's completion handlers,
+         *  when run from the reactor or a posted completion, to f rather than
+         *  out of io_service::run()
+         *  \remark must be set before the socket's first async operation
+         */
+        void set_handler_error(implementation_type & impl,
+                               std::function<void(std::exception_ptr)> f) {
+            unique_lock l{ *impl };
+            impl->handler_error_ = std::move(f);
+        }
+
         asio::error_code cancel(implementation_type & impl,
                                          asio::error_code & ec) {
             unique_lock l{ *impl };
@@ -480,6 +663,7 @@ namespace detail {
 
     private:
         context_type ctx_;
+        recycling_allocator alloc_;
 
         bool is_shutdown(implementation_type & impl, op_type o, asio::error_code & ec) {
             if (is_shutdown(o, impl->shutdown_)) {
@@ -497,11 +681,8 @@ namespace detail {
         static void cancel_ops(implementation_type & impl) {
             op_queue_type ops;
             impl->cancel_ops(reactor_op::canceled(), ops);
-            while (!ops.empty()) {
-                auto op = ops.front();
-                ops.pop_front();
-                reactor_op::reactor_op::do_complete(&op.get());
-            }
+            while (auto op = ops.pop())
+                reactor_op::do_complete(op);
         }
 
         using weak_descriptor_ptr = std::weak_ptr<per_descriptor_data>;
@@ -522,11 +703,7 @@ namespace detail {
                 if (ec)
                     impl->cancel_ops(ec, ops);
             }
-            while (!ops.empty()) {
-                auto op = ops.front();
-                ops.pop_front();
-                reactor_op::reactor_op::do_complete(&op.get());
-            }
+            impl->complete(ops);
         }
 
         void check_missed_events(implementation_type & impl)
@@ -540,46 +717,97 @@ namespace detail {
             if (evs || ec)
             {
                 impl->missed_events_found_ = true;
+                impl->stats_.missed_event_post();
                 weak_descriptor_ptr weak_impl(impl);
-                impl->sd_->get_io_service().post([weak_impl, ec]() { handle_missed_events(weak_impl, ec); });
+                impl->post([weak_impl, ec]() { handle_missed_events(weak_impl, ec); });
             }
         }
 
+        // sockets with a pending reactor wait, keyed by native handle and
+        // sharded so that registration from different threads rarely contends.
+        // Handles are mixed before picking a shard, Windows SOCKETs are
+        // multiples of 4 and would otherwise only use a quarter of them. An
+        // entry outlives its registration, so a socket going busy again does
+        // not allocate, until a sweep finds its socket destroyed.
         struct descriptor_map {
             ~descriptor_map() {
-                lock_type l{ mutex_ };
-                for(auto&& descriptor : map_)
-                    if (auto impl = descriptor.second.lock()) {
-                        cancel_ops(impl);
+                for (auto & s : shards_) {
+                    lock_type l{ s.mutex_ };
+                    for (auto&& e : s.entries_) {
+                        auto impl = e.second.impl_.lock();
+                        if (impl && e.second.registered_)
+                            cancel_ops(impl);
                     }
+                }
             }
 
             void register_descriptor(implementation_type & impl) {
-                lock_type l{ mutex_ };
-                auto handle = impl->sd_->native_handle();
-                map_.emplace(handle, impl);
+                auto handle = static_cast<size_t>(impl->sd_->native_handle());
+                auto & s = shard_for(handle);
+                lock_type l{ s.mutex_ };
+                auto res = s.entries_.emplace(handle, entry());
+                res.first->second.impl_ = impl;
+                res.first->second.registered_ = true;
+                if (res.second && s.entries_.size() > 2 * s.swept_size_ + min_sweep)
+                    s.sweep();
             }
 
             void unregister_descriptor(implementation_type & impl) {
-                lock_type l{ mutex_ };
-                auto handle = impl->sd_->native_handle();
-                map_.erase(handle);
+                auto handle = static_cast<size_t>(impl->sd_->native_handle());
+                auto & s = shard_for(handle);
+                lock_type l{ s.mutex_ };
+                auto it = s.entries_.find(handle);
+                // the handle may have been reused by a newer socket since
+                if (it != std::end(s.entries_) && it->second.impl_.lock() == impl)
+                    it->second.registered_ = false;
             }
 
         private:
-            mutable std::mutex mutex_;
             using lock_type = std::unique_lock<std::mutex>;
-            using key_type = socket_ops::native_handle_type;
-            std::map<key_type, weak_descriptor_ptr> map_;
+
+            enum { shard_bits = 4, max_shards = 1 << shard_bits, min_sweep = 64 };
+
+            struct entry {
+                weak_descriptor_ptr impl_;
+                bool registered_ = false;
+            };
+
+            struct shard {
+                mutable std::mutex mutex_;
+                std::unordered_map<size_t, entry> entries_;
+                size_t swept_size_ = 0;
+
+                // drop entries of destroyed sockets, only called when a new
+                // handle is added and the map has doubled since the last
+                // sweep, so the cost is amortized over the insertions
+                void sweep() {
+                    for (auto it = std::begin(entries_); it != std::end(entries_);) {
+                        if (it->second.impl_.expired())
+                            it = entries_.erase(it);
+                        else
+                            ++it;
+                    }
+                    swept_size_ = entries_.size();
+                }
+            };
+            std::array<shard, max_shards> shards_;
+
+            shard & shard_for(size_t handle) {
+                auto h = static_cast<uint64_t>(handle) * 0x9e3779b97f4a7c15ull;
+                return shards_[static_cast<size_t>(h >> (64 - shard_bits))];
+            }
         };
 
         struct reactor_handler {
             descriptor_map & descriptors_;
+            recycling_allocator & alloc_;
             weak_descriptor_ptr per_descriptor_data_;
 
             reactor_handler(descriptor_map & descriptors,
+                            recycling_allocator & alloc,
                             implementation_type const& per_descriptor_data)
                 : descriptors_(descriptors)
+                , alloc_(alloc)
                 , per_descriptor_data_(per_descriptor_data)
             { }
 
@@ -591,68 +819,99 @@ namespace detail {
                 op_queue_type ops;
                 {
                     unique_lock l{ *p };
+                    p->stats_.reactor_wakeup();
 
-                    if (!ec)
+                    if (!ec) {
                         p->scheduled_ = p->perform_ops(ops, ec);
+                        if (!p->scheduled_ && !ec)
+                            p->scheduled_ = p->keep_armed(!ops.empty());
+                    }
                     if (ec) {
                         p->scheduled_ = false;
                         p->cancel_ops(ec, ops);
                     }
 
                     if (p->scheduled_)
-                        p->sd_->async_read_some(asio::null_buffers(), *this);
+                        p->async_wait(*this);
                     else
                         descriptors_.unregister_descriptor(p);
                 }
-                while (!ops.empty()) {
-                    auto op = ops.front();
-                    ops.pop_front();
-                    reactor_op::reactor_op::do_complete(&op.get());
-                }
+                p->complete(ops);
             }
 
-            static void schedule(descriptor_map & descriptors, implementation_type & impl) {
-                reactor_handler handler(descriptors, impl);
+            static void schedule(descriptor_map & descriptors,
+                                 recycling_allocator & alloc,
+                                 implementation_type & impl) {
+                reactor_handler handler(descriptors, alloc, impl);
                 descriptors.register_descriptor(impl);
 
                 asio::error_code ec;
                 auto evs = socket_ops::get_events(impl->socket_, ec) & impl->events_mask();
 
                 if (evs || ec) {
-                    impl->sd_->get_io_service().post([handler, ec] { handler(ec, 0); });
+                    impl->post([handler, ec] { handler(ec, 0); });
                 } else {
-                    impl->sd_->async_read_some(asio::null_buffers(),
-                                                std::move(handler));
+                    impl->async_wait(std::move(handler));
                 }
             }
+
+            friend
+            void* asio_handler_allocate(size_t size, reactor_handler* handler) {
+                return handler->alloc_.allocate(size);
+            }
+
+            friend
+            void asio_handler_deallocate(void* p, size_t, reactor_handler*) {
+                recycling_allocator::deallocate(p);
+            }
         };
 
         struct deferred_completion {
             weak_descriptor_ptr owner_;
             reactor_op *op_;
+            recycling_allocator * alloc_;
+            op_type o_;
 
             deferred_completion(implementation_type const& owner,
-                                reactor_op_ptr op)
+                                reactor_op_ptr op,
+                                recycling_allocator & alloc,
+                                op_type o)
                 : owner_(owner)
                 , op_(op.release())
+                , alloc_(&alloc)
+                , o_(o)
             { }
 
             void operator()() {
-                reactor_op::do_complete(op_);
-                if (auto p = owner_.lock()) {
-                    unique_lock l{ *p };
-                    p->in_speculative_completion_ = false;
-                }
+                auto p = owner_.lock();
+                if (!p)
+                    return reactor_op::do_complete(op_);
+                if (socket_stats_counter::enabled)
+                    p->stats_.completed(o_, true, *op_);
+                p->complete(op_);
+                unique_lock l{ *p };
+                p->in_speculative_completion_ = false;
             }
 
             friend
             bool asio_handler_is_continuation(deferred_completion* handler) { return true; }
+
+            friend
+            void* asio_handler_allocate(size_t size, deferred_completion* handler) {
+                return handler->alloc_->allocate(size);
+            }
+
+            friend
+            void asio_handler_deallocate(void* p, size_t, deferred_completion*) {
+                recycling_allocator::deallocate(p);
+            }
         };
 
         descriptor_map descriptors_;
 
         asio::error_code enqueue(implementation_type & impl,
                                         op_type o, reactor_op_ptr & op) {
+            op->stamp();
             unique_lock l{ *impl };
             asio::error_code ec;
             if (is_shutdown(impl, o, ec))
@@ -662,19 +921,25 @@ namespace detail {
             if (impl->allow_speculative_ && !impl->in_speculative_completion_) {
                 // attempt to execute speculatively when the op_queue is empty
                 if (impl->op_queue_[o].empty()) {
-                    if (op->do_perform(impl->socket_)) {
+                    auto hit = op->do_perform(impl->socket_);
+                    impl->stats_.speculative(hit);
+                    if (hit) {
+                        if (!op->ec_)
+                            impl->stats_.completed(o, op->bytes_transferred_ - op->truncated(),
+                                                 op->messages());
                         impl->in_speculative_completion_ = true;
                         l.unlock();
-                        get_io_service().post(deferred_completion(impl, std::move(op)));
+                        impl->post(deferred_completion(impl, std::move(op), alloc_, o));
                         return ec;
                     }
                 }
             }
-            impl->op_queue_[o].push_back(*op.release());
+            impl->op_queue_[o].push(op.release());
+            impl->stats_.queued(o);
 
             if (!impl->scheduled_) {
                 impl->scheduled_ = true;
-                reactor_handler::schedule(descriptors_, impl);
+                reactor_handler::schedule(descriptors_, alloc_, impl);
             } else {
                 check_missed_events(impl);
             }
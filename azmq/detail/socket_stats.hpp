@@ -0,0 +1,317 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_DETAIL_SOCKET_STATS_HPP_
+#define AZMQ_DETAIL_SOCKET_STATS_HPP_
+
+#include "../error.hpp"
+
+#include <asio/error_code.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <system_error>
+
+namespace azmq {
+namespace detail {
+    /** \brief Per socket counters, see socket::stats
+     *  \remark messages_* count whole messages, a multipart message is
+     *  counted once, when its last part has been sent or received
+     */
+    struct socket_stats {
+        uint64_t bytes_sent = 0;
+        uint64_t bytes_received = 0;
+        uint64_t messages_sent = 0;
+        uint64_t messages_received = 0;
+        uint64_t speculative_hits = 0;
+        uint64_t speculative_misses = 0;
+        uint64_t reactor_wakeups = 0;
+        uint64_t missed_event_posts = 0;
+        uint64_t would_block_retries = 0;
+        uint64_t max_queue_depth = 0;
+        uint64_t cancels = 0;
+    };
+
+    /** \brief Log-bucketed histogram of op latencies in nanoseconds
+     *  \remark Each power of two range is split into 4 linear sub-buckets,
+     *  so a bucket is at most 25% wide. The last bucket covers
+     *  [7 * 2^38, 2^41) ns and also takes every value of 2^41 ns (about 37
+     *  minutes) and above, so its upper_bound() is not a true bound.
+     */
+    struct latency_histogram {
+        enum : size_t {
+            sub_bucket_bits = 2,
+            sub_buckets = 1 << sub_bucket_bits,
+            max_log2 = 40,
+            bucket_count = (max_log2 - sub_bucket_bits + 2) * sub_buckets
+        };
+
+        std::array<uint64_t, bucket_count> counts = {{ }};
+
+        static size_t bucket(uint64_t ns) {
+            if (ns < sub_buckets)
+                return static_cast<size_t>(ns);
+            size_t msb = 63 - count_leading_zeros(ns);
+            auto shift = msb - sub_bucket_bits;
+            auto sub = static_cast<size_t>(ns >> shift) & (sub_buckets - 1);
+            auto b = (shift + 1) * sub_buckets + sub;
+            return b < bucket_count ? b : bucket_count - 1;
+        }
+
+        /** \brief smallest value, in nanoseconds, recorded in bucket b */
+        static uint64_t lower_bound(size_t b) {
+            if (b < sub_buckets)
+                return b;
+            auto shift = b / sub_buckets - 1;
+            return static_cast<uint64_t>(sub_buckets + b % sub_buckets) << shift;
+        }
+
+        /** \brief largest value, in nanoseconds, recorded in bucket b */
+        static uint64_t upper_bound(size_t b) {
+            if (b < sub_buckets)
+                return b;
+            auto shift = b / sub_buckets - 1;
+            return lower_bound(b) + (uint64_t(1) << shift) - 1;
+        }
+
+        uint64_t count() const {
+            uint64_t res = 0;
+            for (auto c : counts)
+                res += c;
+            return res;
+        }
+
+        /** \brief upper bound of the bucket holding the p'th quantile,
+         *  p in [0, 1], 0 if the histogram is empty
+         */
+        uint64_t percentile(double p) const {
+            auto total = count();
+            if (!total)
+                return 0;
+            auto rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t b = 0; b != bucket_count; ++b) {
+                seen += counts[b];
+                if (seen >= rank)
+                    return upper_bound(b);
+            }
+            return upper_bound(bucket_count - 1);
+        }
+
+    private:
+        static size_t count_leading_zeros(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_clzll(v);
+#else
+            size_t n = 64;
+            while (v) { v >>= 1; --n; }
+            return n;
+#endif
+        }
+    };
+
+    /** \brief Time from enqueue to completion of async operations, see
+     *  socket::latency
+     */
+    struct socket_latency {
+        latency_histogram read_speculative;
+        latency_histogram read_reactor;
+        latency_histogram write_speculative;
+        latency_histogram write_reactor;
+    };
+
+    // counting is only compiled in when AZMQ_ENABLE_SOCKET_STATS is defined,
+    // otherwise every hook is an empty inline function. The classes below
+    // differ in layout between the two, so translation units disagreeing on
+    // the macro violate the ODR, define it for the whole program.
+#ifdef AZMQ_ENABLE_SOCKET_STATS
+    // base of reactor_op, remembers when the op was enqueued, how many
+    // whole messages it has transferred and how many of the bytes it reports
+    // were dropped by truncating a part to a too small buffer
+    class op_stats {
+    public:
+        void stamp() { enqueued_ = std::chrono::steady_clock::now(); }
+
+        uint64_t elapsed_ns() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - enqueued_).count();
+        }
+
+        void count_messages(size_t n) { messages_ += n; }
+        size_t messages() const { return messages_; }
+
+        void count_truncated(size_t n) { truncated_ += n; }
+        size_t truncated() const { return truncated_; }
+
+    private:
+        std::chrono::steady_clock::time_point enqueued_;
+        size_t messages_ = 0;
+        size_t truncated_ = 0;
+    };
+
+    // striped so threads completing ops on the same socket rarely share a
+    // cache line, stripes are summed when read. At about 20KB it is only
+    // allocated once a socket enables socket::track_latency.
+    class latency_recorder {
+    public:
+        latency_recorder() {
+            for (auto & stripe : stripes_)
+                for (auto & h : stripe)
+                    for (auto & c : h)
+                        c.store(0, std::memory_order_relaxed);
+        }
+
+        void record(size_t which, uint64_t ns) {
+            stripes_[this_stripe()][which][latency_histogram::bucket(ns)]
+                .fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void snapshot(socket_latency & res) const {
+            latency_histogram* hs[max_histograms] = {
+                &res.read_speculative, &res.read_reactor,
+                &res.write_speculative, &res.write_reactor
+            };
+            for (size_t h = 0; h != max_histograms; ++h) {
+                hs[h]->counts.fill(0);
+                for (auto const& stripe : stripes_)
+                    for (size_t b = 0; b != latency_histogram::bucket_count; ++b)
+                        hs[h]->counts[b] += stripe[h][b].load(std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        enum : size_t { max_stripes = 4, max_histograms = 4 };
+        using buckets_type = std::array<std::atomic<uint64_t>, latency_histogram::bucket_count>;
+        std::array<std::array<buckets_type, max_histograms>, max_stripes> stripes_;
+
+        static size_t this_stripe() {
+            static std::atomic<size_t> next{ 0 };
+            thread_local size_t stripe = next++ % max_stripes;
+            return stripe;
+        }
+    };
+
+    class socket_stats_counter {
+    public:
+        enum : unsigned { read_op = 0, write_op = 1 };
+        static constexpr bool enabled = true;
+
+        void completed(unsigned o, size_t bytes, size_t messages) {
+            if (o == write_op) {
+                stats_.bytes_sent += bytes;
+                stats_.messages_sent += messages;
+            } else {
+                stats_.bytes_received += bytes;
+                stats_.messages_received += messages;
+            }
+        }
+
+        void speculative(bool hit) {
+            if (hit) ++stats_.speculative_hits;
+            else ++stats_.speculative_misses;
+        }
+
+        void reactor_wakeup() { ++stats_.reactor_wakeups; }
+        void missed_event_post() { ++stats_.missed_event_posts; }
+        void would_block() { ++stats_.would_block_retries; }
+        void canceled() { ++stats_.cancels; }
+
+        void queued(unsigned o) {
+            if (++depth_[o] > stats_.max_queue_depth)
+                stats_.max_queue_depth = depth_[o];
+        }
+
+        void dequeued(unsigned o) { --depth_[o]; }
+
+        void completed(unsigned o, bool speculative, op_stats const& op) {
+            if (auto l = latency_.load(std::memory_order_acquire))
+                l->record(o * 2 + (speculative ? 0 : 1), op.elapsed_ns());
+        }
+
+        // called with the socket's lock held, the recorder is kept once
+        // allocated so completions racing a disable never see it freed
+        asio::error_code track_latency(bool on, asio::error_code & ec) {
+            if (on && !recorder_)
+                recorder_.reset(new latency_recorder);
+            latency_.store(on ? recorder_.get() : nullptr, std::memory_order_release);
+            return ec = asio::error_code();
+        }
+
+        bool tracking_latency() const {
+            return latency_.load(std::memory_order_relaxed) != nullptr;
+        }
+
+        asio::error_code get(void* pv, size_t size, asio::error_code & ec) const {
+            if (size < sizeof(socket_stats))
+                return ec = make_error_code(std::errc::invalid_argument);
+            std::memcpy(pv, &stats_, sizeof(socket_stats));
+            return ec = asio::error_code();
+        }
+
+        asio::error_code get_latency(void* pv, size_t size, asio::error_code & ec) const {
+            if (size < sizeof(socket_latency))
+                return ec = make_error_code(std::errc::invalid_argument);
+            if (recorder_)
+                recorder_->snapshot(*static_cast<socket_latency*>(pv));
+            else
+                *static_cast<socket_latency*>(pv) = socket_latency();
+            return ec = asio::error_code();
+        }
+
+    private:
+        socket_stats stats_;
+        std::unique_ptr<latency_recorder> recorder_;
+        std::atomic<latency_recorder*> latency_{ nullptr };
+        std::array<uint64_t, 2> depth_ = {{ 0, 0 }};
+    };
+#else
+    class op_stats {
+    public:
+        void stamp() { }
+        void count_messages(size_t) { }
+        size_t messages() const { return 0; }
+        void count_truncated(size_t) { }
+        size_t truncated() const { return 0; }
+    };
+
+    class socket_stats_counter {
+    public:
+        static constexpr bool enabled = false;
+
+        void completed(unsigned, size_t, size_t) { }
+        void speculative(bool) { }
+        void reactor_wakeup() { }
+        void missed_event_post() { }
+        void would_block() { }
+        void canceled() { }
+        void queued(unsigned) { }
+        void dequeued(unsigned) { }
+        void completed(unsigned, bool, op_stats const&) { }
+
+        asio::error_code track_latency(bool, asio::error_code & ec) {
+            return ec = make_error_code(std::errc::not_supported);
+        }
+
+        bool tracking_latency() const { return false; }
+
+        asio::error_code get(void*, size_t, asio::error_code & ec) const {
+            return ec = make_error_code(std::errc::not_supported);
+        }
+
+        asio::error_code get_latency(void*, size_t, asio::error_code & ec) const {
+            return ec = make_error_code(std::errc::not_supported);
+        }
+    };
+#endif
+} // namespace detail
+} // namespace azmq
+#endif // AZMQ_DETAIL_SOCKET_STATS_HPP_
@@ -0,0 +1,255 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_ENVELOPE_HPP_
+#define AZMQ_ENVELOPE_HPP_
+
+#include "message.hpp"
+#include "shared_message.hpp"
+
+#include <asio/buffer.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace azmq {
+namespace detail {
+    // character arrays, e.g. string literals, are one part rather than a
+    // range of chars
+    template<typename T, typename = void>
+    struct is_frame_range : std::false_type { };
+
+    template<typename T>
+    struct is_frame_range<T, decltype(void(std::begin(std::declval<T const&>())),
+                                      void(std::end(std::declval<T const&>())))>
+        : std::integral_constant<bool, !std::is_convertible<T const&, char const*>::value> { };
+
+    inline void append_frames(small_message_vector & parts, message const& msg) {
+        parts.emplace_back(msg);
+    }
+
+    inline void append_frames(small_message_vector & parts, shared_message const& msg) {
+        parts.emplace_back(msg.share());
+    }
+
+    inline void append_frames(small_message_vector & parts, asio::const_buffer const& buffer) {
+        parts.emplace_back(buffer);
+    }
+
+    inline void append_frames(small_message_vector & parts, std::string const& str) {
+        parts.emplace_back(str);
+    }
+
+    inline void append_frames(small_message_vector & parts, char const* str) {
+        parts.emplace_back(asio::buffer(str, std::strlen(str)));
+    }
+
+    // a sequence of any of the above, one part each
+    template<typename Range>
+    auto append_frames(small_message_vector & parts, Range const& range) ->
+        typename std::enable_if<is_frame_range<Range>::value>::type
+    {
+        for (auto const& f : range)
+            append_frames(parts, f);
+    }
+} // namespace detail
+
+AZMQ_V1_INLINE_NAMESPACE_BEGIN
+
+    /** \brief Identity of a peer as a key for per peer tables
+     *  \remark Holds the identity frame by reference count, or inline for
+     *  identities of up to 32 bytes such as the ones libzmq generates, and
+     *  caches its hash. Copying an identity never copies the bytes of a
+     *  larger identity and never allocates for a small one.
+     */
+    class identity {
+    public:
+        identity() noexcept
+            : hash_(hash_bytes(nullptr, 0))
+        { }
+
+        explicit identity(message const& frame)
+            : frame_(frame)
+            , hash_(hash_bytes(frame_.data(), frame_.size()))
+        { }
+
+        message const& frame() const noexcept { return frame_; }
+        asio::const_buffer buffer() const noexcept { return frame_.cbuffer(); }
+        std::string string() const { return frame_.string(); }
+        size_t size() const noexcept { return frame_.size(); }
+        size_t hash() const noexcept { return hash_; }
+
+        bool operator==(identity const& rhs) const noexcept {
+            return hash_ == rhs.hash_ && frame_ == rhs.frame_;
+        }
+
+        bool operator!=(identity const& rhs) const noexcept {
+            return !operator==(rhs);
+        }
+
+        bool operator<(identity const& rhs) const noexcept {
+            auto n = std::min(size(), rhs.size());
+            auto r = n ? std::memcmp(frame_.data(), rhs.frame_.data(), n) : 0;
+            return r < 0 || (r == 0 && size() < rhs.size());
+        }
+
+    private:
+        message frame_;
+        size_t hash_;
+
+        // FNV-1a, identities are short
+        static size_t hash_bytes(void const* data, size_t size) noexcept {
+            auto p = static_cast<unsigned char const*>(data);
+            uint64_t h = 14695981039346656037ull;
+            for (size_t i = 0; i != size; ++i) {
+                h ^= p[i];
+                h *= 1099511628211ull;
+            }
+            return static_cast<size_t>(h);
+        }
+    };
+
+    /** \brief A multipart message received on a ROUTER socket, split into
+     *  its routing frames and its body
+     *  \remark The routing frames are the identities up to the empty
+     *  delimiter frame, or just the first frame if there is no delimiter,
+     *  as with a DEALER peer which does not send one. The envelope owns the
+     *  received parts, routing() and body() are views over them, nothing is
+     *  copied. Replies re-send the routing frames by reference count, see
+     *  socket::reply().
+     */
+    class envelope {
+    public:
+        using parts_type = small_message_vector;
+        using const_iterator = parts_type::const_iterator;
+
+        /** \brief view of consecutive parts of an envelope */
+        class frames {
+        public:
+            frames(const_iterator first, const_iterator last) noexcept
+                : first_(first)
+                , last_(last)
+            { }
+
+            const_iterator begin() const noexcept { return first_; }
+            const_iterator end() const noexcept { return last_; }
+            size_t size() const noexcept { return last_ - first_; }
+            bool empty() const noexcept { return first_ == last_; }
+            message const& operator[](size_t i) const noexcept { return first_[i]; }
+
+        private:
+            const_iterator first_;
+            const_iterator last_;
+        };
+
+        envelope() noexcept
+            : routing_end_(0)
+            , body_begin_(0)
+        { }
+
+        /** \brief take over the parts of a received message
+         *  \param parts small_message_vector&&
+         */
+        explicit envelope(parts_type && parts)
+            : parts_(std::move(parts))
+        { split(); }
+
+        /** \brief take over the parts of a received message
+         *  \param parts message_vector&&
+         */
+        explicit envelope(message_vector && parts)
+            : parts_(std::make_move_iterator(parts.begin()), std::make_move_iterator(parts.end()))
+        {
+            parts.clear();
+            split();
+        }
+
+        /** \brief routing frames, without the delimiter */
+        frames routing() const noexcept {
+            return frames(parts_.begin(), parts_.begin() + routing_end_);
+        }
+
+        /** \brief frames following the routing frames and delimiter */
+        frames body() const noexcept {
+            return frames(parts_.begin() + body_begin_, parts_.end());
+        }
+
+        /** \brief true if the routing frames were followed by an empty
+         *  delimiter, which replies then include as well
+         */
+        bool has_delimiter() const noexcept { return body_begin_ != routing_end_; }
+
+        /** \brief identity of the peer the message arrived from, the first
+         *  routing frame
+         */
+        identity peer() const {
+            return routing_end_ ? identity(parts_[0]) : identity();
+        }
+
+        parts_type const& parts() const noexcept { return parts_; }
+
+        /** \brief give up the parts, the envelope is left empty */
+        parts_type release() noexcept {
+            routing_end_ = body_begin_ = 0;
+            return std::move(parts_);
+        }
+
+        /** \brief parts of a reply, the routing frames and delimiter
+         *  followed by body
+         *  \tparam Body message, shared_message, asio::const_buffer,
+         *  std::string, a string literal or char const*, or a sequence of
+         *  those, each of which becomes one part
+         *  \remark The routing frames and messages in body are shared by
+         *  reference count, buffers and strings are copied. A string
+         *  literal's part does not include its terminating nul.
+         */
+        template<typename Body>
+        parts_type reply_parts(Body const& body) const {
+            parts_type res;
+            res.reserve(body_begin_ + 1);
+            for (size_t i = 0; i != body_begin_; ++i)
+                res.emplace_back(parts_[i]);
+            detail::append_frames(res, body);
+            return res;
+        }
+
+    private:
+        parts_type parts_;
+        size_t routing_end_;
+        size_t body_begin_;
+
+        void split() {
+            auto n = parts_.size();
+            for (size_t i = 0; i != n; ++i) {
+                if (parts_[i].size() == 0) {
+                    routing_end_ = i;
+                    body_begin_ = i + 1;
+                    return;
+                }
+            }
+            routing_end_ = body_begin_ = n ? 1 : 0;
+        }
+    };
+
+AZMQ_V1_INLINE_NAMESPACE_END
+} // namespace azmq
+
+namespace std {
+    template<>
+    struct hash<azmq::identity> {
+        size_t operator()(azmq::identity const& id) const noexcept { return id.hash(); }
+    };
+} // namespace std
+#endif // AZMQ_ENVELOPE_HPP_
@@ -11,6 +11,7 @@
 
 #include "error.hpp"
 #include "util/scope_guard.hpp"
+#include "util/small_vector.hpp"
 
 #include <cassert>
 #include <asio/buffer.hpp>
@@ -19,6 +20,8 @@
 
 #include <zmq.h>
 
+#include <atomic>
+#include <cstdint>
 #include <type_traits>
 #include <memory>
 #include <vector>
@@ -37,23 +40,28 @@ AZMQ_V1_INLINE_NAMESPACE_BEGIN
 
     constexpr nocopy_t nocopy = nocopy_t{};
 
+    class shared_message;
+
     struct message {
         typedef void (free_fn) (void *data);
 
         using flags_type = int;
 
         message() noexcept {
+            set_shared_state(state_exclusive);
             auto rc = zmq_msg_init(&msg_);
             assert((rc == 0)&&("zmq_msg_init return non-zero")); (void)rc;
         }
 
         explicit message(size_t size) {
+            set_shared_state(state_exclusive);
             auto rc = zmq_msg_init_size(&msg_, size);
             if (rc)
                 throw asio::system_error(make_error_code());
         }
 
         message(asio::const_buffer const& buffer) {
+            set_shared_state(state_exclusive);
             auto sz = asio::buffer_size(buffer);
             auto rc = zmq_msg_init_size(&msg_, sz);
             if (rc)
@@ -128,14 +136,21 @@ AZMQ_V1_INLINE_NAMESPACE_BEGIN
         message(message && rhs) noexcept
             : msg_(rhs.msg_)
         {
+            set_shared_state(rhs.shared_state());
             auto rc = zmq_msg_init(&rhs.msg_);
             assert((rc == 0)&&("zmq_msg_init return non-zero")); (void)rc;
+            rhs.set_shared_state(state_exclusive);
         }
 
         message& operator=(message && rhs) noexcept {
+            if (this == &rhs)
+                return *this;
+            close();
             msg_ = rhs.msg_;
+            set_shared_state(rhs.shared_state());
             auto rc = zmq_msg_init(&rhs.msg_);
             assert((rc == 0)&&("zmq_msg_init return non-zero")); (void)rc;
+            rhs.set_shared_state(state_exclusive);
 
             return *this;
         }
@@ -147,6 +162,7 @@ AZMQ_V1_INLINE_NAMESPACE_BEGIN
                               const_cast<zmq_msg_t*>(&rhs.msg_));
             if (rc)
                 throw asio::system_error(make_error_code());
+            rhs.copied();
         }
 
         message& operator=(message const& rhs) {
@@ -154,6 +170,8 @@ AZMQ_V1_INLINE_NAMESPACE_BEGIN
                                    const_cast<zmq_msg_t*>(&rhs.msg_));
             if (rc)
                 throw asio::system_error(make_error_code());
+            set_shared_state(state_unknown);
+            rhs.copied();
             return *this;
         }
 
@@ -216,6 +234,7 @@ AZMQ_V1_INLINE_NAMESPACE_BEGIN
 
     private:
         friend detail::socket_ops;
+        friend class shared_message;
         zmq_msg_t msg_;
 
         void close() noexcept {
@@ -223,8 +242,49 @@ AZMQ_V1_INLINE_NAMESPACE_BEGIN
             assert((rc == 0)&&("zmq_msg_close return non-zero")); (void)rc;
         }
 
-        // note, this is a bit fragile, currently the last two bytes in a
-        // zmq_msg_t hold the type and flags fields
+        // whether the payload may be referenced by another zmq_msg_t
+        enum : uint8_t {
+            state_unknown,
+            state_exclusive,
+            state_shared
+        };
+
+#if ZMQ_VERSION >= ZMQ_MAKE_VERSION(4, 1, 0)
+        // libzmq answers through zmq_msg_get(ZMQ_SHARED), which is cheap
+        // enough to ask every time, so nothing is cached and a message stays
+        // exactly the size of a zmq_msg_t
+        uint8_t shared_state() const noexcept { return state_unknown; }
+        void set_shared_state(uint8_t) const noexcept { }
+
+        // true for payloads with more than one reference and for constant
+        // payloads from message(nocopy_t, asio::const_buffer)
+        bool is_shared() const noexcept {
+            return zmq_msg_get(const_cast<zmq_msg_t*>(&msg_), ZMQ_SHARED) == 1;
+        }
+#else
+        // cached until the next operation which could change it
+        mutable std::atomic<uint8_t> shared_state_{ state_unknown };
+
+        uint8_t shared_state() const noexcept {
+            return shared_state_.load(std::memory_order_relaxed);
+        }
+
+        void set_shared_state(uint8_t s) const noexcept {
+            shared_state_.store(s, std::memory_order_relaxed);
+        }
+
+        bool is_shared() const noexcept {
+            auto s = shared_state();
+            if (s == state_unknown) {
+                s = query_shared() ? state_shared : state_exclusive;
+                set_shared_state(s);
+            }
+            return s == state_shared;
+        }
+
+        // note, this is a bit fragile, libzmq before 4.1 has no ZMQ_SHARED
+        // property, and in those versions the last two bytes in a zmq_msg_t
+        // hold the type and flags fields
         enum {
             flags_offset = sizeof(zmq_msg_t) - 1,
             type_offset = sizeof(zmq_msg_t) - 2
@@ -249,10 +309,21 @@ AZMQ_V1_INLINE_NAMESPACE_BEGIN
             type_cmsg = 104
         };
 
-        bool is_shared() const noexcept {
-            // TODO use shared message property if libzmq version >= 4.1
+        bool query_shared() const noexcept {
             return (flags() & flag_shared) || type() == type_cmsg;
         }
+#endif
+
+        // zmq_msg_copy marks the source shared unless the payload is small
+        // enough to be copied, let the next is_shared() ask libzmq
+        void copied() const noexcept {
+            if (shared_state() != state_unknown)
+                set_shared_state(state_unknown);
+        }
+
+        // called by socket_ops after libzmq replaced msg_
+        void received() noexcept { set_shared_state(state_unknown); }
+        void sent() noexcept { set_shared_state(state_exclusive); }
 
         void deep_copy() {
             auto sz = size();
@@ -273,14 +344,32 @@ AZMQ_V1_INLINE_NAMESPACE_BEGIN
             auto pdst = zmq_msg_data(const_cast<zmq_msg_t*>(&msg_));
             auto psrc = zmq_msg_data(&tmp);
             ::memcpy(pdst, psrc, sz);
+            set_shared_state(state_exclusive);
         }
     };
 
+#if ZMQ_VERSION >= ZMQ_MAKE_VERSION(4, 1, 0)
+    // nothing is cached when libzmq reports ZMQ_SHARED, keep it that way
+    static_assert(sizeof(message) == sizeof(zmq_msg_t),
+                  "message must not add state to zmq_msg_t");
+#endif
+
     using message_vector = std::vector<message>;
 
-    template<typename BufferSequence>
-    message_vector to_message_vector(BufferSequence const& buffers) {
-        return message_vector(std::begin(buffers), std::end(buffers));
+    /** \brief message_vector alternative holding up to 4 parts inline, enough
+     *  for a typical ROUTER/DEALER envelope (identity, delimiter, header,
+     *  body), so collecting a message does not allocate for the container.
+     *  Accepted wherever a message_vector is filled or sent.
+     */
+    using small_message_vector = util::small_vector<message, 4>;
+
+    /** \brief copy each buffer to a message part
+     *  \tparam MessageVector message_vector or small_message_vector
+     */
+    template<typename MessageVector = message_vector,
+             typename BufferSequence>
+    MessageVector to_message_vector(BufferSequence const& buffers) {
+        return MessageVector(std::begin(buffers), std::end(buffers));
     }
 AZMQ_V1_INLINE_NAMESPACE_END
 } // namespace azmq
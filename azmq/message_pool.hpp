@@ -0,0 +1,100 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_MESSAGE_POOL_HPP_
+#define AZMQ_MESSAGE_POOL_HPP_
+
+#include "message.hpp"
+#include "detail/message_pool_core.hpp"
+
+#include <asio/buffer.hpp>
+
+#include <cstddef>
+
+namespace azmq {
+AZMQ_V1_INLINE_NAMESPACE_BEGIN
+
+    /** \brief Source of messages whose payload comes from size-classed slabs
+     *  rather than from zmq_msg_init_size's malloc.
+     *  \remark Payloads from 33 bytes to 64KiB are rounded up to the next
+     *  power of two, 64 bytes at least, and carved from slabs, with a per
+     *  thread cache of released blocks. When libzmq drops the last reference
+     *  to a frame its block goes back to the pool, on whatever thread that
+     *  happens. Smaller payloads are stored inline in the zmq_msg_t by libzmq
+     *  and larger ones are allocated as usual, both are returned as plain
+     *  messages.
+     *
+     *  Messages may outlive the pool. Slab memory is released once the pool
+     *  and every message and thread cache using it are gone.
+     *
+     *  A message_pool may be used concurrently from any number of threads.
+     */
+    class message_pool {
+    public:
+        message_pool()
+            : core_(detail::message_pool_core::create())
+        { }
+
+        ~message_pool() {
+            core_->flush_this_thread();
+            core_->release_ref();
+        }
+
+        message_pool(message_pool const&) = delete;
+        message_pool & operator=(message_pool const&) = delete;
+
+        /** \brief largest payload served from the pool */
+        static size_t max_size() { return detail::message_pool_core::max_size(); }
+
+        /** \brief payloads up to this size are stored inline in the
+         *  zmq_msg_t by libzmq and never come from the pool
+         */
+        static size_t max_inline_size() { return 32; }
+
+        /** \brief message with an uninitialized payload of size bytes
+         *  \param size size_t
+         */
+        message get(size_t size) {
+            if (!pooled(size))
+                return message(size);
+            return make(core_->acquire(detail::message_pool_core::size_class(size)), size);
+        }
+
+        /** \brief message holding a copy of buffer
+         *  \param buffer asio::const_buffer const&
+         */
+        message get(asio::const_buffer const& buffer) {
+            auto size = asio::buffer_size(buffer);
+            if (!pooled(size))
+                return message(buffer);
+            auto b = core_->acquire(detail::message_pool_core::size_class(size));
+            asio::buffer_copy(asio::buffer(b->data(), size), buffer);
+            return make(b, size);
+        }
+
+    private:
+        detail::message_pool_core* core_;
+
+        static bool pooled(size_t size) {
+            return size > max_inline_size() && size <= max_size();
+        }
+
+        static message make(detail::message_pool_core::block* b, size_t size) {
+            try {
+                return message(nocopy, asio::mutable_buffer(b->data(), size),
+                               b, &detail::message_pool_core::release);
+            } catch (...) {
+                detail::message_pool_core::release(b->data(), b);
+                throw;
+            }
+        }
+    };
+
+AZMQ_V1_INLINE_NAMESPACE_END
+} // namespace azmq
+#endif // AZMQ_MESSAGE_POOL_HPP_
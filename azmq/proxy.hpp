@@ -0,0 +1,330 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_PROXY_HPP_
+#define AZMQ_PROXY_HPP_
+
+#include "socket.hpp"
+#include "detail/send_op.hpp"
+#include "detail/socket_service.hpp"
+#include "detail/config/mutex.hpp"
+#include "detail/config/lock_guard.hpp"
+
+#include <asio/io_service.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace azmq {
+namespace detail {
+    class proxy_state
+        : public std::enable_shared_from_this<proxy_state> {
+    public:
+        struct direction {
+            socket & in;
+            socket & out;
+            message_vector frames;
+            std::atomic<size_t> messages;
+            std::atomic<size_t> bytes;
+            bool idle;
+            bool disabled;
+
+            direction(socket & i, socket & o)
+                : in(i)
+                , out(o)
+                , messages(0)
+                , bytes(0)
+                , idle(true)
+                , disabled(false)
+            { }
+        };
+
+        proxy_state(socket && frontend, socket && backend,
+                    std::unique_ptr<socket> capture, size_t batch)
+            : frontend_(std::move(frontend))
+            , backend_(std::move(backend))
+            , capture_(std::move(capture))
+            , batch_(std::max<size_t>(1, batch))
+            , forward_(frontend_, backend_)
+            , reverse_(backend_, frontend_)
+            , paused_(false)
+            , terminated_(false)
+        { }
+
+        void start() {
+            lock_type l{ mutex_ };
+            arm(forward_);
+            arm(reverse_);
+        }
+
+        void pause() {
+            lock_type l{ mutex_ };
+            paused_ = true;
+        }
+
+        void resume() {
+            lock_type l{ mutex_ };
+            if (!paused_ || terminated_)
+                return;
+            paused_ = false;
+            arm(forward_);
+            arm(reverse_);
+        }
+
+        void terminate(asio::error_code const& ec = asio::error_code()) {
+            {
+                lock_type l{ mutex_ };
+                if (terminated_)
+                    return;
+                terminated_ = true;
+                last_error_ = ec;
+            }
+            asio::error_code ignored;
+            frontend_.cancel(ignored);
+            backend_.cancel(ignored);
+            if (capture_)
+                capture_->cancel(ignored);
+        }
+
+        bool is_paused() const {
+            lock_type l{ mutex_ };
+            return paused_;
+        }
+
+        bool is_terminated() const {
+            lock_type l{ mutex_ };
+            return terminated_;
+        }
+
+        asio::error_code last_error() const {
+            lock_type l{ mutex_ };
+            return last_error_;
+        }
+
+        direction const& forward() const { return forward_; }
+        direction const& reverse() const { return reverse_; }
+
+    private:
+        using lock_type = lock_guard_t<mutex_t>;
+
+        socket frontend_;
+        socket backend_;
+        std::unique_ptr<socket> capture_;
+        size_t batch_;
+        direction forward_;
+        direction reverse_;
+
+        mutable mutex_t mutex_;
+        mutex_t capture_mutex_;
+        bool paused_;
+        bool terminated_;
+        asio::error_code last_error_;
+
+        // called with mutex_ held, starts receiving unless the direction is
+        // already busy, paused or terminated
+        void arm(direction & d) {
+            if (!d.idle || d.disabled || paused_ || terminated_)
+                return;
+            d.idle = false;
+            receive(d);
+        }
+
+        // a direction's next receive is only started once everything it
+        // received before has been accepted by the output socket, so input
+        // pauses while the output is at its high water mark
+        void rearm(direction & d) {
+            lock_type l{ mutex_ };
+            d.idle = true;
+            arm(d);
+        }
+
+        void receive(direction & d) {
+            auto self = shared_from_this();
+            d.in.async_receive_batch(d.frames, batch_, [self, &d](asio::error_code const& ec, size_t bytes) {
+                self->received(d, ec, bytes);
+            });
+        }
+
+        void received(direction & d, asio::error_code const& ec, size_t bytes) {
+            if (ec == std::errc::not_supported) {
+                // a send only input, such as PUSH or PUB, leaves the
+                // direction unused as it would be with zmq_proxy
+                lock_type l{ mutex_ };
+                d.disabled = true;
+                d.idle = true;
+                return;
+            }
+            if (ec) {
+                if (ec != asio::error::operation_aborted)
+                    terminate(ec);
+                return;
+            }
+
+            size_t messages = 0;
+            for (auto const& f : d.frames)
+                messages += !f.more();
+            d.messages += messages;
+            d.bytes += bytes;
+
+            if (capture_)
+                capture(d.frames);
+
+            // the frames are moved into the op and handed back for reuse
+            using handler_type = forwarded_handler;
+            using op_type = send_frames_op<message_vector, handler_type>;
+            socket_service::core_access access{ d.out };
+            access.service().enqueue<op_type>(access.implementation(),
+                                              socket_service::op_type::write_op,
+                                              handler_type{ shared_from_this(), &d },
+                                              std::move(d.frames), 0);
+        }
+
+        struct forwarded_handler {
+            std::shared_ptr<proxy_state> self_;
+            direction* d_;
+
+            void operator()(asio::error_code const& ec, size_t, message_vector & frames) {
+                d_->frames = std::move(frames);
+                if (ec) {
+                    if (ec != asio::error::operation_aborted)
+                        self_->terminate(ec);
+                    return;
+                }
+                self_->rearm(*d_);
+            }
+        };
+
+        // as with zmq_proxy, every part is also sent to the capture socket,
+        // here without blocking. A part it does not accept is dropped with
+        // the rest of its message, the next message starts afresh. Both
+        // directions capture, so the whole batch is sent under capture_mutex_
+        // to keep their messages from interleaving.
+        void capture(message_vector const& frames) {
+            lock_type l{ capture_mutex_ };
+            asio::error_code ec;
+            auto skip = false;
+            for (auto const& f : frames) {
+                if (!skip) {
+                    ec = asio::error_code();
+                    capture_->send(message(f), f.more() ? ZMQ_SNDMORE | ZMQ_DONTWAIT
+                                                        : ZMQ_DONTWAIT, ec);
+                    skip = !!ec;
+                }
+                if (!f.more())
+                    skip = false;
+            }
+        }
+    };
+} // namespace detail
+
+AZMQ_V1_INLINE_NAMESPACE_BEGIN
+
+    /** \brief Forwarding device between two sockets, the asio counterpart of
+     *  zmq_proxy
+     *  \remark Whole multipart messages are shuttled in both directions,
+     *  the parts are moved from socket to socket, never copied. Each wakeup
+     *  of an input socket drains up to batch messages, which are then sent
+     *  on in a single operation. The next batch is only received once the
+     *  output has taken the last one, so an output at its high water mark
+     *  pauses the input feeding it rather than queueing without bound.
+     *
+     *  The proxy owns its sockets and runs on their io_service, it starts
+     *  forwarding as soon as it is constructed. pause(), resume() and
+     *  terminate() may be called from any thread. Destroying the proxy
+     *  terminates it.
+     */
+    class proxy {
+    public:
+        /** \brief throughput of one direction of the proxy */
+        struct statistics {
+            size_t messages;
+            size_t bytes;
+        };
+
+        static constexpr size_t default_batch = 64;
+
+        /** \brief forward between frontend and backend
+         *  \param frontend socket&&
+         *  \param backend socket&&
+         *  \param batch size_t maximum number of messages received per wakeup
+         */
+        proxy(socket && frontend, socket && backend, size_t batch = default_batch)
+            : state_(std::make_shared<detail::proxy_state>(std::move(frontend), std::move(backend),
+                                                           nullptr, batch))
+        { state_->start(); }
+
+        /** \brief forward between frontend and backend, sending a copy of
+         *  every message part to capture as well
+         *  \param frontend socket&&
+         *  \param backend socket&&
+         *  \param capture socket&&, copies are sent by reference count
+         *  \param batch size_t maximum number of messages received per wakeup
+         */
+        proxy(socket && frontend, socket && backend, socket && capture,
+              size_t batch = default_batch)
+            : state_(std::make_shared<detail::proxy_state>(std::move(frontend), std::move(backend),
+                                                           std::unique_ptr<socket>(new socket(std::move(capture))),
+                                                           batch))
+        { state_->start(); }
+
+        proxy(proxy && rhs) = default;
+
+        /** \brief the proxy replaced is terminated */
+        proxy & operator=(proxy && rhs) {
+            if (state_ && state_ != rhs.state_)
+                state_->terminate();
+            state_ = std::move(rhs.state_);
+            return *this;
+        }
+
+        ~proxy() {
+            if (state_)
+                state_->terminate();
+        }
+
+        /** \brief stop receiving, messages already received are still
+         *  forwarded
+         *  \remark A receive already outstanding on either input is not
+         *  withdrawn, so one more batch per direction may still be received
+         *  and forwarded after pause() returns.
+         */
+        void pause() { state_->pause(); }
+
+        /** \brief start receiving again after pause() */
+        void resume() { state_->resume(); }
+
+        /** \brief stop forwarding for good, outstanding operations on the
+         *  proxy's sockets are cancelled
+         */
+        void terminate() { state_->terminate(); }
+
+        bool is_paused() const { return state_->is_paused(); }
+
+        /** \brief true once terminated, by terminate() or by an error */
+        bool is_terminated() const { return state_->is_terminated(); }
+
+        /** \brief the error which terminated the proxy, if any */
+        asio::error_code last_error() const { return state_->last_error(); }
+
+        statistics frontend_to_backend() const { return stats(state_->forward()); }
+        statistics backend_to_frontend() const { return stats(state_->reverse()); }
+
+    private:
+        std::shared_ptr<detail::proxy_state> state_;
+
+        static statistics stats(detail::proxy_state::direction const& d) {
+            return statistics{ d.messages.load(), d.bytes.load() };
+        }
+    };
+
+AZMQ_V1_INLINE_NAMESPACE_END
+} // namespace azmq
+#endif // AZMQ_PROXY_HPP_
@@ -0,0 +1,118 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_SHARED_MESSAGE_HPP_
+#define AZMQ_SHARED_MESSAGE_HPP_
+
+#include "message.hpp"
+
+#include <asio/buffer.hpp>
+
+#include <zmq.h>
+
+#include <cassert>
+#include <memory>
+#include <string>
+
+namespace azmq {
+AZMQ_V1_INLINE_NAMESPACE_BEGIN
+
+    /** \brief Immutable message payload, built once and shared by reference
+     *  count between every copy and every send.
+     *  \remark Copying a shared_message, or sending it, only bumps libzmq's
+     *  reference count on the payload, so the same update can be fanned out
+     *  to many sockets without copying it. There is no mutable access,
+     *  clone() returns a message with a private copy of the payload for
+     *  explicit copy-on-write.
+     *
+     *  Distinct shared_message objects referring to the same payload may be
+     *  copied, sent and destroyed concurrently from different threads.
+     */
+    class shared_message {
+    public:
+        shared_message() = default;
+
+        /** \brief copy buffer into a new shared payload */
+        explicit shared_message(asio::const_buffer const& buffer)
+            : msg_(buffer)
+        { prime(); }
+
+        explicit shared_message(std::string const& str)
+            : shared_message(asio::buffer(str.data(), str.size()))
+        { }
+
+        /** \brief take over msg's payload */
+        explicit shared_message(message && msg)
+            : msg_(std::move(msg))
+        { prime(); }
+
+        /** \brief share buffer without copying it, buffer must stay valid
+         *  for as long as owner is held. owner is released when the last
+         *  reference to the payload, including those held by libzmq, is
+         *  dropped.
+         *  \param owner std::shared_ptr<T> keeping buffer alive
+         *  \param buffer asio::const_buffer const&
+         */
+        template<typename T>
+        shared_message(std::shared_ptr<T> owner, asio::const_buffer const& buffer)
+            : msg_(nocopy,
+                   asio::mutable_buffer(const_cast<void*>(asio::buffer_cast<void const*>(buffer)),
+                                        asio::buffer_size(buffer)),
+                   [owner](void*) { })
+        { prime(); }
+
+        shared_message(shared_message const& rhs) = default;
+        shared_message & operator=(shared_message const& rhs) = default;
+        shared_message(shared_message && rhs) = default;
+        shared_message & operator=(shared_message && rhs) = default;
+
+        asio::const_buffer buffer() const noexcept { return msg_.cbuffer(); }
+        asio::const_buffer cbuffer() const noexcept { return msg_.cbuffer(); }
+        operator asio::const_buffer() const noexcept { return msg_.cbuffer(); }
+
+        void const* data() const noexcept { return msg_.data(); }
+        size_t size() const noexcept { return msg_.size(); }
+        std::string string() const { return msg_.string(); }
+
+        /** \brief message referring to the shared payload, as handed to
+         *  socket::send
+         */
+        message share() const { return msg_; }
+
+        /** \brief message with a private copy of the payload, which may be
+         *  modified freely
+         */
+        message clone() const { return message(msg_.cbuffer()); }
+
+        bool operator==(shared_message const& rhs) const noexcept { return msg_ == rhs.msg_; }
+        bool operator!=(shared_message const& rhs) const noexcept { return msg_ != rhs.msg_; }
+
+    private:
+        message msg_;
+
+        // libzmq marks a payload shared on its first zmq_msg_copy, writing to
+        // the source message non atomically. Doing that once here means later
+        // copies only touch the atomic reference count.
+        void prime() {
+            zmq_msg_t tmp;
+            auto rc = zmq_msg_init(&tmp);
+            assert((rc == 0)&&("zmq_msg_init return non-zero"));
+            rc = zmq_msg_copy(&tmp, const_cast<zmq_msg_t*>(&msg_.msg_));
+            if (rc) {
+                zmq_msg_close(&tmp);
+                throw asio::system_error(make_error_code());
+            }
+            rc = zmq_msg_close(&tmp);
+            assert((rc == 0)&&("zmq_msg_close return non-zero")); (void)rc;
+            msg_.copied();
+        }
+    };
+
+AZMQ_V1_INLINE_NAMESPACE_END
+} // namespace azmq
+#endif // AZMQ_SHARED_MESSAGE_HPP_
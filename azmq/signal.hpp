@@ -10,10 +10,94 @@
 #define AZMQ_SIGNAL_HPP_
 
 #include "socket.hpp"
+#include "detail/async_initiate.hpp"
+#include "detail/handler_dispatch.hpp"
+
+#include <cstring>
+#include <type_traits>
+#include <utility>
 
 namespace azmq {
 namespace signal {
 AZMQ_V1_INLINE_NAMESPACE_BEGIN
+namespace detail {
+    enum : uint64_t {
+        signal_mask = 0xffffffffffff00u,
+        signal_base = 0x77664433221100u
+    };
+
+    // signals are always exactly 8 bytes, so they are stored inline in the
+    // zmq_msg_t and never allocate
+    inline asio::const_buffer encode(uint64_t & v, uint8_t status) {
+        v = signal_base + status;
+        return asio::const_buffer(&v, sizeof(v));
+    }
+
+    // true if msg is a signal, status is set from it
+    inline bool decode(message const& msg, uint8_t & status) {
+        if (msg.size() != sizeof(uint64_t) || msg.more())
+            return false;
+        uint64_t v;
+        std::memcpy(&v, msg.data(), sizeof(v));
+        if ((v & signal_mask) != signal_base)
+            return false;
+        status = v & 255;
+        return true;
+    }
+
+    // part of a message that is not a signal, kept in pending if supplied
+    inline void skip(message && msg, message_vector * pending) {
+        if (pending)
+            pending->push_back(std::move(msg));
+    }
+
+    template<typename Handler>
+    class wait_op {
+    public:
+        wait_op(socket & s, message_vector * pending, Handler && handler)
+            : socket_(&s)
+            , pending_(pending)
+            , in_message_(false)
+            , handler_(std::move(handler))
+        { }
+
+        void operator()(asio::error_code const& ec, message msg) {
+            uint8_t status = 0;
+            if (ec) {
+                azmq::detail::dispatch_handler(handler_, ec, status);
+                return;
+            }
+
+            if (!in_message_ && decode(msg, status)) {
+                azmq::detail::dispatch_handler(handler_, ec, status);
+                return;
+            }
+
+            in_message_ = msg.more();
+            skip(std::move(msg), pending_);
+            auto s = socket_;
+            s->async_receive_message(std::move(*this));
+        }
+
+    private:
+        socket* socket_;
+        message_vector* pending_;
+        bool in_message_;
+        Handler handler_;
+    };
+
+    struct initiate_wait {
+        socket* socket_;
+        message_vector* pending_;
+
+        template<typename WaitHandler>
+        void operator()(WaitHandler && handler) const {
+            using type = wait_op<typename std::decay<WaitHandler>::type>;
+            socket_->async_receive_message(type(*socket_, pending_, std::forward<WaitHandler>(handler)));
+        }
+    };
+} // namespace detail
+
 /** \brief Send a signal over a socket. A signal is a short message carrying a
  *  success/failure code (by convention, 0 means OK). Signals are encoded to be
  *  distinguishable from "normal" messages.
@@ -22,11 +106,10 @@ AZMQ_V1_INLINE_NAMESPACE_BEGIN
  *  \param ec asio::error_code&
  *  \return asio::error_code
  */
-asio::error_code send(socket & s, uint8_t status,
+inline asio::error_code send(socket & s, uint8_t status,
                                asio::error_code & ec) {
-    uint64_t v = 0x77664433221100u + status;
-    auto buf = asio::buffer(&v, sizeof(v));
-    s.send(buf, 0, ec);
+    uint64_t v;
+    s.send(detail::encode(v, status), 0, ec);
     return ec;
 }
 
@@ -37,48 +120,116 @@ asio::error_code send(socket & s, uint8_t status,
  *  \param status uint8_t to send
  *  \throw asio::system_error
  */
-void send(socket & s, uint8_t status) {
+inline void send(socket & s, uint8_t status) {
     asio::error_code ec;
     if (send(s, status, ec))
         throw asio::system_error(ec);
 }
 
+/** \brief Initiate an async send of a signal over a socket.
+ *  \tparam WriteHandler must conform to the asio WriteHandler concept, or be
+ *          a completion token such as asio::use_future
+ *  \param s socket& to signal on
+ *  \param status uint8_t to send
+ *  \param handler WriteHandler
+ *  \remark The signal is encoded into a message by the call itself, which
+ *  the operation holds by value, so it is safe with tokens such as
+ *  asio::deferred which start the operation later.
+ */
+template<typename WriteHandler>
+auto async_send(socket & s, uint8_t status, WriteHandler && handler) ->
+    azmq::detail::async_result_t<WriteHandler, void(asio::error_code, size_t)>
+{
+    uint64_t v;
+    return s.async_send(message(detail::encode(v, status)), std::forward<WriteHandler>(handler));
+}
+
 /** \brief Wait on a signal from a socket. Use this with signal() to coordiante
  *  over thread/actor pipes
  *  \param s socket& to receive signal from
+ *  \param pending message_vector* receiving the parts of any messages which
+ *  arrive ahead of the signal, in order, or nullptr to discard them
  *  \param ec asio::error_code
  *  \return signal
  */
-uint8_t wait(socket & s, asio::error_code & ec) {
+inline uint8_t wait(socket & s, message_vector * pending, asio::error_code & ec) {
     message msg;
+    auto in_message = false;
     while (true) {
-        auto sz = s.receive(msg, 0, ec);
+        s.receive(msg, 0, ec);
         if (ec)
             return 0;
-        if (sz == sizeof(uint64_t)) {
-            auto v = msg.buffer_cast<uint64_t>();
-            if ((v & 0xffffffffffff00u) == 0x77664433221100u)
-                return v & 255;
-        }
+        uint8_t status;
+        if (!in_message && detail::decode(msg, status))
+            return status;
+        in_message = msg.more();
+        detail::skip(std::move(msg), pending);
     }
 }
 
 /** \brief Wait on a signal from a socket. Use this with signal() to coordiante
  *  over thread/actor pipes
  *  \param s socket& to receive signal from
+ *  \param ec asio::error_code
+ *  \return signal
+ *  \remark messages which arrive ahead of the signal are discarded, use the
+ *  overload taking a message_vector* to keep them
+ */
+inline uint8_t wait(socket & s, asio::error_code & ec) {
+    return wait(s, nullptr, ec);
+}
+
+/** \brief Wait on a signal from a socket. Use this with signal() to coordiante
+ *  over thread/actor pipes
+ *  \param s socket& to receive signal from
+ *  \param pending message_vector* receiving messages which arrive ahead of
+ *  the signal, or nullptr to discard them
  *  \return signal
  *  \throw asio::system_error
  */
-uint8_t wait(socket & s) {
+inline uint8_t wait(socket & s, message_vector * pending = nullptr) {
     asio::error_code ec;
-    auto res = wait(s, ec);
+    auto res = wait(s, pending, ec);
     if (ec)
         throw asio::system_error(ec);
     return res;
 }
 
+/** \brief Initiate an async wait on a signal from a socket, the calling thread
+ *  is not blocked.
+ *  \tparam WaitHandler a handler with the signature
+ *          void(asio::error_code const& ec, uint8_t status), or a completion
+ *          token such as asio::use_future
+ *  \param s socket& to receive signal from
+ *  \param pending message_vector* receiving the parts of any messages which
+ *  arrive ahead of the signal, in order, or nullptr to discard them. It must
+ *  remain valid until the handler is called.
+ *  \param handler WaitHandler
+ */
+template<typename WaitHandler>
+auto async_wait(socket & s, message_vector * pending, WaitHandler && handler) ->
+    azmq::detail::async_result_t<WaitHandler, void(asio::error_code, uint8_t)>
+{
+    return azmq::detail::async_initiate<void(asio::error_code, uint8_t), WaitHandler>(
+                detail::initiate_wait{ &s, pending }, handler);
+}
+
+/** \brief Initiate an async wait on a signal from a socket, messages which
+ *  arrive ahead of the signal are discarded.
+ *  \tparam WaitHandler a handler with the signature
+ *          void(asio::error_code const& ec, uint8_t status), or a completion
+ *          token such as asio::use_future
+ *  \param s socket& to receive signal from
+ *  \param handler WaitHandler
+ */
+template<typename WaitHandler>
+auto async_wait(socket & s, WaitHandler && handler) ->
+    azmq::detail::async_result_t<WaitHandler, void(asio::error_code, uint8_t)>
+{
+    return async_wait(s, nullptr, std::forward<WaitHandler>(handler));
+}
+
 AZMQ_V1_INLINE_NAMESPACE_END
 } // namespace signal
 } // namespace azmq
 #endif // AZMQ_SIGNAL_HPP_
-
@@ -13,9 +13,12 @@
 #include "option.hpp"
 #include "context.hpp"
 #include "message.hpp"
+#include "shared_message.hpp"
+#include "envelope.hpp"
 #include "detail/basic_io_object.hpp"
 #include "detail/send_op.hpp"
 #include "detail/receive_op.hpp"
+#include "detail/async_initiate.hpp"
 
 #include <asio/basic_io_object.hpp>
 #include <asio/io_service.hpp>
@@ -42,6 +45,24 @@ public:
 
     // socket options
     using allow_speculative = detail::socket_service::allow_speculative;
+    // milliseconds to keep the reactor wait armed after the last op completes,
+    // 0 (the default) disarms it as soon as no ops are pending. There is no
+    // timer, the period is only checked when the wait next wakes up, so an
+    // idle socket stays registered until its descriptor next signals
+    using sticky_registration = detail::socket_service::sticky_registration;
+    // read-only snapshot of detail::socket_stats, requires
+    // AZMQ_ENABLE_SOCKET_STATS, not_supported otherwise. The macro changes the
+    // layout of azmq's internal types, so it must be defined identically in
+    // every translation unit of a program, best as a compile definition
+    // (-DAZMQ_ENABLE_SOCKET_STATS), never by a #define ahead of an #include
+    using stats = detail::socket_service::stats;
+    // read-only snapshot of detail::socket_latency, enqueue to completion
+    // histograms of async ops, same requirement as stats. Empty unless
+    // track_latency has been enabled on the socket.
+    using latency = detail::socket_service::latency;
+    // record async op latencies for the latency option, off by default, the
+    // histograms are allocated when it is first enabled
+    using track_latency = detail::socket_service::track_latency;
     using type = opt::integer<ZMQ_TYPE>;
     using rcv_more = opt::integer<ZMQ_RCVMORE>;
     using rcv_hwm = opt::integer<ZMQ_RCVHWM>;
@@ -110,6 +131,27 @@ public:
             throw asio::system_error(ec);
     }
 
+    /** \brief socket constructor
+     *  \param strand reference to an asio::io_service::strand
+     *  \param s_type int socket type
+     *      For socket types see the zeromq documentation
+     *  \remarks
+     *      The socket does not take a mutex around calls to ZeroMQ APIs,
+     *      all internal completions, and so all completion handlers, are
+     *      run through the supplied strand instead. Every call on the socket
+     *      must itself be made from within the strand, e.g. from a
+     *      completion handler or via strand.dispatch(). The socket keeps
+     *      its own copy of the strand handle, which refers to the same
+     *      strand, so the strand object passed in need not outlive it.
+     */
+    socket(asio::io_service::strand & strand,
+           int type)
+            : azmq::detail::basic_io_object<detail::socket_service>(strand.get_io_service()) {
+        asio::error_code ec;
+        if (get_service().do_open(implementation, type, strand, ec))
+            throw asio::system_error(ec);
+    }
+
     socket(socket&& other)
         : azmq::detail::basic_io_object<detail::socket_service>(other.get_io_service()) {
         get_service().move_construct(implementation,
@@ -303,6 +345,17 @@ public:
      *  the returned size will be zero. It is the callers responsibility to issue
      *  additional receive calls to collect the remaining message parts or
      *  flush to discard them.
+     *
+     *  \warning If buffers holds exactly one buffer the message part is
+     *  received directly into it, and a part larger than the buffer is
+     *  silently truncated. Unlike with several buffers this is not an error,
+     *  ec is not set to no_buffer_space, and the returned size is the full
+     *  size of the part, so it exceeds the buffer's size whenever data was
+     *  lost. Callers must compare the two, or receive into a message, to
+     *  detect truncation. Further parts of a multipart message are only
+     *  reported, by setting ec to no_buffer_space, when flags has
+     *  ZMQ_RCVMORE set, as that check costs a getsockopt per call.
+     *  Otherwise they are left for the next receive.
      */
     template<typename MutableBufferSequence>
     std::size_t receive(MutableBufferSequence const& buffers,
@@ -331,6 +384,17 @@ public:
      *  the returned size will be zero. It is the callers responsibility to issue
      *  additional receive calls to collect the remaining message parts or
      *  flush to discard them.
+     *
+     *  \warning If buffers holds exactly one buffer the message part is
+     *  received directly into it, and a part larger than the buffer is
+     *  silently truncated. Unlike with several buffers this is not an error,
+     *  ec is not set to no_buffer_space, and the returned size is the full
+     *  size of the part, so it exceeds the buffer's size whenever data was
+     *  lost. Callers must compare the two, or receive into a message, to
+     *  detect truncation. Further parts of a multipart message are only
+     *  reported, by setting ec to no_buffer_space, when flags has
+     *  ZMQ_RCVMORE set, as that check costs a getsockopt per call.
+     *  Otherwise they are left for the next receive.
      */
     template<typename MutableBufferSequence>
     std::size_t receive(const MutableBufferSequence & buffers,
@@ -379,24 +443,28 @@ public:
     }
 
     /** \brief Receive all parts of a multipart message from the socket
-     *  \param vec message_vector to fill on receive
+     *  \tparam MessageVector message_vector or small_message_vector
+     *  \param vec MessageVector to fill on receive
      *  \flags specifying how the receive call is to be made
      *  \param ec set to indicate what error, if any, occurred
      *  \return size_t bytes transferred
      */
-    size_t receive_more(message_vector & vec,
+    template<typename MessageVector>
+    size_t receive_more(MessageVector & vec,
                         flags_type flags,
                         asio::error_code & ec) {
         return get_service().receive_more(implementation, vec, flags, ec);
     }
 
     /** \brief Receive all parts of a multipart message from the socket
-     *  \param vec messave_vector to fill on receive
+     *  \tparam MessageVector message_vector or small_message_vector
+     *  \param vec MessageVector to fill on receive
      *  \flags specifying how the receive call is to be made
      *  \return size_t bytes transferred
      *  \throw asio::system_error
      */
-    size_t receive_more(message_vector & vec,
+    template<typename MessageVector>
+    size_t receive_more(MessageVector & vec,
                         flags_type flags) {
         asio::error_code ec;
         auto res = receive_more(vec, flags, ec);
@@ -412,7 +480,9 @@ public:
      *  \param ec set to indicate what, if any, error occurred
      *  \remark
      *  If buffers is a sequence of buffers this call will send a multipart
-     *  message from the supplied buffer sequence.
+     *  message from the supplied buffer sequence. A message_vector or
+     *  small_message_vector is sent as a multipart message without copying
+     *  the payloads, each part shares its payload with the supplied message.
      */
     template<typename ConstBufferSequence>
     std::size_t send(ConstBufferSequence const& buffers,
@@ -440,6 +510,44 @@ public:
         return res;
     }
 
+    /** \brief Send some data from the socket without copying it
+     *  \tparam ConstBufferSequence
+     *  \param buffers buffer(s) to send
+     *  \param flags specifying how the send call is to be made
+     *  \param ec set to indicate what, if any, error occurred
+     *  \remark
+     *  Each buffer is handed to libzmq by reference as a separate message
+     *  part. The caller must keep the underlying memory valid and unchanged
+     *  until libzmq releases it, which may be after this call returns. Use
+     *  the async_send nocopy overload to be notified of the release.
+     */
+    template<typename ConstBufferSequence>
+    std::size_t send(nocopy_t,
+                     ConstBufferSequence const& buffers,
+                     flags_type flags,
+                     asio::error_code & ec) {
+        return get_service().send(implementation, nocopy, buffers, flags, ec);
+    }
+
+    /** \brief Send some data from the socket without copying it
+     *  \tparam ConstBufferSequence
+     *  \param buffers buffer(s) to send
+     *  \param flags specifying how the send call is to be made
+     *  \throw asio::system_error
+     *  \remark
+     *  See the error_code overload for buffer lifetime requirements.
+     */
+    template<typename ConstBufferSequence>
+    std::size_t send(nocopy_t,
+                     ConstBufferSequence const& buffers,
+                     flags_type flags = 0) {
+        asio::error_code ec;
+        auto res = send(nocopy, buffers, flags, ec);
+        if (ec)
+            throw asio::system_error(ec);
+        return res;
+    }
+
     /** \brief Send some data from the socket
      *  \param msg raw_message to send
      *  \param flags specifying how the send call is to be made
@@ -465,6 +573,72 @@ public:
         return res;
     }
 
+    /** \brief Send a shared message from the socket
+     *  \param msg shared_message to send, it is left unchanged and may be
+     *  sent again, e.g. to other sockets
+     *  \param flags specifying how the send call is to be made
+     *  \param ec set to indicate what, if any, error occurred
+     */
+    std::size_t send(shared_message const& msg,
+                     flags_type flags,
+                     asio::error_code & ec) {
+        return get_service().send(implementation, msg.share(), flags, ec);
+    }
+
+    /** \brief Send a shared message from the socket
+     *  \param msg shared_message to send, it is left unchanged and may be
+     *  sent again, e.g. to other sockets
+     *  \param flags specifying how the send call is to be made
+     *  \return bytes transferred
+     */
+    std::size_t send(shared_message const& msg,
+                     flags_type flags = 0) {
+        asio::error_code ec;
+        auto res = send(msg, flags, ec);
+        if (ec)
+            throw asio::system_error(ec);
+        return res;
+    }
+
+    /** \brief Reply to the sender of a message received on a ROUTER socket
+     *  \tparam Body message, shared_message, asio::const_buffer, std::string,
+     *          a string literal, or a sequence of those, each of which
+     *          becomes one part
+     *  \param env envelope of the message being replied to
+     *  \param body Body of the reply
+     *  \param flags specifying how the send call is to be made
+     *  \param ec set to indicate what, if any, error occurred
+     *  \remark
+     *  The routing frames and delimiter of env are sent by reference count,
+     *  followed by the body, as one multipart message. env is unchanged and
+     *  may be replied to again.
+     */
+    template<typename Body>
+    std::size_t reply(envelope const& env,
+                      Body const& body,
+                      flags_type flags,
+                      asio::error_code & ec) {
+        auto parts = env.reply_parts(body);
+        return get_service().send(implementation,
+                                  detail::message_parts<envelope::parts_type>{ parts },
+                                  flags, ec);
+    }
+
+    /** \brief Reply to the sender of a message received on a ROUTER socket
+     *  \see reply(envelope const&, Body const&, flags_type, asio::error_code &)
+     *  \throw asio::system_error
+     */
+    template<typename Body>
+    std::size_t reply(envelope const& env,
+                      Body const& body,
+                      flags_type flags = 0) {
+        asio::error_code ec;
+        auto res = reply(env, body, flags, ec);
+        if (ec)
+            throw asio::system_error(ec);
+        return res;
+    }
+
     /* \brief Purge remaining message parts from prior receive()
      * \param ec asio::error_code &
      * \return size_t number of bytes discarded
@@ -487,7 +661,8 @@ public:
 
     /** \brief Initiate an async receive operation.
      *  \tparam MutableBufferSequence
-     *  \tparam ReadHandler must conform to the asio ReadHandler concept
+     *  \tparam ReadHandler must conform to the asio ReadHandler concept,
+     *          or be a completion token such as asio::use_future
      *  \param buffers buffer(s) to fill on receive
      *  \param handler ReadHandler
      *  \remark
@@ -500,20 +675,28 @@ public:
      *  to no_buffer_space. It is the callers responsibility to issue
      *  additional receive calls to collect the remaining message parts or
      *  call flush to discard them.
+     *
+     *  \warning If buffers holds exactly one buffer a part larger than the
+     *  buffer is silently truncated, as with receive(). The handler gets no
+     *  error and the full size of the part as bytes_transferred, which
+     *  exceeds the buffer's size whenever data was lost. Further parts are
+     *  only reported with no_buffer_space when flags has ZMQ_RCVMORE set.
      */
     template<typename MutableBufferSequence,
              typename ReadHandler>
-    void async_receive(MutableBufferSequence const& buffers,
+    auto async_receive(MutableBufferSequence const& buffers,
                        ReadHandler && handler,
-                       flags_type flags = 0) {
-        using type = detail::receive_buffer_op<MutableBufferSequence, ReadHandler>;
-        get_service().enqueue<type>(implementation, detail::socket_service::op_type::read_op,
-                                    buffers, std::forward<ReadHandler>(handler), flags);
+                       flags_type flags = 0) ->
+        detail::async_result_t<ReadHandler, void(asio::error_code, size_t)>
+    {
+        return detail::async_initiate<void(asio::error_code, size_t), ReadHandler>(
+                    initiate_receive<MutableBufferSequence>{ this }, handler, buffers, flags);
     }
 
     /** \brief Initiate an async receive operation.
      *  \tparam MutableBufferSequence
-     *  \tparam ReadMoreHandler must conform to the ReadMoreHandler concept
+     *  \tparam ReadMoreHandler must conform to the ReadMoreHandler concept,
+     *          or be a completion token such as asio::use_future
      *  \param buffers buffer(s) to fill on receive
      *  \param handler ReadMoreHandler
      *  \remark
@@ -532,12 +715,13 @@ public:
      */
     template<typename MutableBufferSequence,
              typename ReadMoreHandler>
-    void async_receive_more(MutableBufferSequence const& buffers,
+    auto async_receive_more(MutableBufferSequence const& buffers,
                             ReadMoreHandler && handler,
-                            flags_type flags = 0) {
-        using type = detail::receive_more_buffer_op<MutableBufferSequence, ReadMoreHandler>;
-        get_service().enqueue<type>(implementation, detail::socket_service::op_type::read_op,
-                                    buffers, std::forward<ReadMoreHandler>(handler), flags);
+                            flags_type flags = 0) ->
+        detail::async_result_t<ReadMoreHandler, void(asio::error_code, more_result_type)>
+    {
+        return detail::async_initiate<void(asio::error_code, more_result_type), ReadMoreHandler>(
+                    initiate_receive_more<MutableBufferSequence>{ this }, handler, buffers, flags);
     }
 
     /** \brief Initate an async receive operation
@@ -557,48 +741,292 @@ public:
      *  message parts. If a handler wishes to retain the supplied message after the
      *  MessageReadHandler returns, it must make an explicit copy or move of
      *  the message.
+     *  \remark
+     *  Completion tokens such as asio::use_future or asio::use_awaitable
+     *  should use async_receive_message(), which passes the message by value.
      */
     template<typename MessageReadHandler>
     void async_receive(MessageReadHandler && handler,
                        flags_type flags = 0) {
-        using type = detail::receive_op<MessageReadHandler>;
+        using type = detail::receive_op<typename std::decay<MessageReadHandler>::type>;
         get_service().enqueue<type>(implementation, detail::socket_service::op_type::read_op,
                                     std::forward<MessageReadHandler>(handler), flags);
     }
 
+    /** \brief Initate an async receive of a message part
+     *  \tparam CompletionToken a handler with the signature
+     *          void(asio::error_code const& ec, message msg), or a
+     *          completion token such as asio::use_future
+     *  \param token CompletionToken
+     *  \param flags int flags
+     *  \remark
+     *  The received part is handed over by value, so with asio::use_awaitable
+     *  the part is the result of co_await. Multipart messages can be handled
+     *  by checking more() on the message.
+     */
+    template<typename CompletionToken>
+    auto async_receive_message(CompletionToken && token,
+                               flags_type flags = 0) ->
+        detail::async_result_t<CompletionToken, void(asio::error_code, message)>
+    {
+        return detail::async_initiate<void(asio::error_code, message), CompletionToken>(
+                    initiate_receive_message{ this }, token, flags);
+    }
+
+    /** \brief Initiate an async receive of one complete, possibly multipart,
+     *  message
+     *  \tparam MessageVector message_vector or small_message_vector
+     *  \tparam ReadHandler must conform to the asio ReadHandler concept, or
+     *          be a completion token such as asio::use_future
+     *  \param vec MessageVector to append the message parts to
+     *  \param handler ReadHandler
+     *  \param flags int flags
+     *  \remark
+     *  Every part of the message is received in one go, without copying, and
+     *  moved to the end of vec, so a ROUTER socket gets the identity frames,
+     *  delimiter and body together. The handler is invoked with the total
+     *  bytes transferred.
+     *  \remark
+     *  vec must remain valid until the handler is invoked. It is not cleared
+     *  first. If an error interrupts the message, the parts received so far
+     *  are left in vec.
+     */
+    template<typename MessageVector,
+             typename ReadHandler>
+    auto async_receive_multipart(MessageVector & vec,
+                                 ReadHandler && handler,
+                                 flags_type flags = 0) ->
+        detail::async_result_t<ReadHandler, void(asio::error_code, size_t)>
+    {
+        return detail::async_initiate<void(asio::error_code, size_t), ReadHandler>(
+                    initiate_receive_multipart<MessageVector>{ this }, handler, &vec, flags);
+    }
+
+    /** \brief Initiate an async receive of a batch of messages
+     *  \tparam ReadHandler must conform to the asio ReadHandler concept, or
+     *          be a completion token such as asio::use_future
+     *  \param vec message_vector to append received message parts to
+     *  \param max_msgs maximum number of messages to receive
+     *  \param handler ReadHandler
+     *  \param flags int flags
+     *  \remark
+     *  Receives up to max_msgs messages that are ready without blocking,
+     *  appending every message part to vec, then invokes the handler once
+     *  with the total bytes transferred. The handler is only invoked once at
+     *  least one message has been received, or an error occurs. A multipart
+     *  message is always received in full and counts as a single message.
+     *  \remark
+     *  vec must remain valid until the handler is invoked. It is not cleared
+     *  first, so the same vector can be cleared and reused across batches
+     *  without reallocating.
+     */
+    template<typename ReadHandler>
+    auto async_receive_batch(message_vector & vec,
+                             size_t max_msgs,
+                             ReadHandler && handler,
+                             flags_type flags = 0) ->
+        detail::async_result_t<ReadHandler, void(asio::error_code, size_t)>
+    {
+        return detail::async_initiate<void(asio::error_code, size_t), ReadHandler>(
+                    initiate_receive_batch{ this }, handler, &vec, max_msgs, flags);
+    }
+
     /** \brief Initiate an async send operation
      *  \tparam ConstBufferSequence must conform to the asio
      *          ConstBufferSequence concept
      *  \tparam WriteHandler must conform to the asio
-     *          WriteHandler concept
+     *          WriteHandler concept, or be a completion token such as
+     *          asio::use_future
      *  \param flags specifying how the send call is to be made
      *  \remark
      *  If buffers is a sequence of buffers, this call will send a multipart
-     *  message from the supplied buffer sequence.
+     *  message from the supplied buffer sequence. The sequence is copied
+     *  into the operation, the memory it refers to must remain valid until
+     *  the handler is invoked. To send frames which are already built
+     *  without copying them, move a message_vector into async_send.
+     */
+    template<typename ConstBufferSequence,
+             typename WriteHandler>
+    auto async_send(ConstBufferSequence const& buffers,
+                    WriteHandler && handler,
+                    flags_type flags = 0) ->
+        detail::async_result_t<WriteHandler, void(asio::error_code, size_t)>
+    {
+        return detail::async_initiate<void(asio::error_code, size_t), WriteHandler>(
+                    initiate_send<ConstBufferSequence>{ this }, handler, buffers, flags);
+    }
+
+    /** \brief Initiate an async send operation without copying the data
+     *  \tparam ConstBufferSequence must conform to the asio
+     *          ConstBufferSequence concept
+     *  \tparam WriteHandler must conform to the asio
+     *          WriteHandler concept, or be a completion token such as
+     *          asio::use_future
+     *  \param flags specifying how the send call is to be made
+     *  \remark
+     *  Each buffer is handed to libzmq by reference as a separate message
+     *  part. The handler is not invoked until libzmq has released every
+     *  part, the caller must keep the underlying memory valid and unchanged
+     *  until then. The operation counts as outstanding work on the
+     *  io_service until the handler is invoked, even after the socket is
+     *  closed, so io_service::run() does not return before then. The
+     *  operation's storage does not depend on the io_service, but its
+     *  completion is posted there, so the io_service must not be destroyed
+     *  before libzmq releases every part.
      */
     template<typename ConstBufferSequence,
              typename WriteHandler>
-    void async_send(ConstBufferSequence const& buffers,
+    auto async_send(nocopy_t,
+                    ConstBufferSequence const& buffers,
                     WriteHandler && handler,
-                    flags_type flags = 0) {
-        using type = detail::send_buffer_op<ConstBufferSequence, WriteHandler>;
-        get_service().enqueue<type>(implementation, detail::socket_service::op_type::write_op,
-                                    buffers, std::forward<WriteHandler>(handler), flags);
+                    flags_type flags = 0) ->
+        detail::async_result_t<WriteHandler, void(asio::error_code, size_t)>
+    {
+        return detail::async_initiate<void(asio::error_code, size_t), WriteHandler>(
+                    initiate_send_nocopy<ConstBufferSequence>{ this }, handler, buffers, flags);
     }
 
     /** \brief Initate an async send operation
-     *  \tparam WriteHandler must conform to the asio WriteHandler concept
+     *  \tparam WriteHandler must conform to the asio WriteHandler concept,
+     *          or be a completion token such as asio::use_future
      *  \param msg message reference
      *  \param handler WriteHandler
      *  \param flags int flags
      */
     template<typename WriteHandler>
-    void async_send(message const& msg,
+    auto async_send(message const& msg,
+                    WriteHandler && handler,
+                    flags_type flags = 0) ->
+        detail::async_result_t<WriteHandler, void(asio::error_code, size_t)>
+    {
+        return detail::async_initiate<void(asio::error_code, size_t), WriteHandler>(
+                    initiate_send_message{ this }, handler, msg, flags);
+    }
+
+    /** \brief Initate an async send of a shared message
+     *  \tparam WriteHandler must conform to the asio WriteHandler concept,
+     *          or be a completion token such as asio::use_future
+     *  \param msg shared_message to send, only its payload reference is
+     *  taken, so msg need not outlive the operation
+     *  \param handler WriteHandler
+     *  \param flags int flags
+     */
+    template<typename WriteHandler>
+    auto async_send(shared_message const& msg,
                     WriteHandler && handler,
-                    flags_type flags = 0) {
-        using type = detail::send_op<WriteHandler>;
-        get_service().enqueue<type>(implementation, detail::socket_service::op_type::write_op,
-                                    msg, std::forward<WriteHandler>(handler), flags);
+                    flags_type flags = 0) ->
+        detail::async_result_t<WriteHandler, void(asio::error_code, size_t)>
+    {
+        return detail::async_initiate<void(asio::error_code, size_t), WriteHandler>(
+                    initiate_send_message{ this }, handler, msg.share(), flags);
+    }
+
+    /** \brief Initiate an async send of a multipart message from frames
+     *  which are already built
+     *  \tparam WriteHandler must conform to the asio WriteHandler concept,
+     *          or be a completion token such as asio::use_future
+     *  \param msgs message_vector&& of parts, the operation takes ownership
+     *  \param handler WriteHandler
+     *  \param flags int flags
+     *  \remark
+     *  The parts are moved out of msgs by the call itself, even with a token
+     *  such as asio::deferred which starts the operation later, so msgs may
+     *  be reused or destroyed as soon as async_send returns.
+     *  \remark
+     *  The parts are handed to libzmq as they are, payloads are never
+     *  copied, so frames built with nocopy deleters stay zero copy. All
+     *  parts go out as one message, if the socket stops accepting part way
+     *  through, the remaining parts follow with the correct ZMQ_SNDMORE
+     *  flags once it accepts again.
+     */
+    template<typename WriteHandler>
+    auto async_send(message_vector && msgs,
+                    WriteHandler && handler,
+                    flags_type flags = 0) ->
+        detail::async_result_t<WriteHandler, void(asio::error_code, size_t)>
+    {
+        return detail::async_initiate<void(asio::error_code, size_t), WriteHandler>(
+                    initiate_send_parts<message_vector>{ this }, handler, std::move(msgs), flags);
+    }
+
+    /** \brief Initiate an async send of a multipart message from frames
+     *  which are already built
+     *  \see async_send(message_vector &&, WriteHandler &&, flags_type)
+     */
+    template<typename WriteHandler>
+    auto async_send(small_message_vector && msgs,
+                    WriteHandler && handler,
+                    flags_type flags = 0) ->
+        detail::async_result_t<WriteHandler, void(asio::error_code, size_t)>
+    {
+        return detail::async_initiate<void(asio::error_code, size_t), WriteHandler>(
+                    initiate_send_parts<small_message_vector>{ this }, handler, std::move(msgs), flags);
+    }
+
+    /** \brief Initiate an async reply to the sender of a message received
+     *  on a ROUTER socket
+     *  \tparam Body message, shared_message, asio::const_buffer, std::string,
+     *          a string literal, or a sequence of those, each of which
+     *          becomes one part
+     *  \tparam WriteHandler must conform to the asio WriteHandler concept,
+     *          or be a completion token such as asio::use_future
+     *  \param env envelope of the message being replied to
+     *  \param body Body of the reply
+     *  \param handler WriteHandler
+     *  \param flags int flags
+     *  \remark
+     *  The routing frames and delimiter of env are taken by reference count
+     *  and sent with the body in a single operation, as one multipart
+     *  message. The parts are built by the call itself, so neither env nor
+     *  body need outlive it, even with a token such as asio::deferred which
+     *  starts the operation later. Buffers in body are copied.
+     */
+    template<typename Body,
+             typename WriteHandler>
+    auto async_reply(envelope const& env,
+                     Body const& body,
+                     WriteHandler && handler,
+                     flags_type flags = 0) ->
+        detail::async_result_t<WriteHandler, void(asio::error_code, size_t)>
+    {
+        return detail::async_initiate<void(asio::error_code, size_t), WriteHandler>(
+                    initiate_send_parts<envelope::parts_type>{ this }, handler,
+                    env.reply_parts(body), flags);
+    }
+
+    /** \brief Initiate an async send of a batch of messages
+     *  \tparam MessageRange a type implementing begin() and end() over
+     *          a sequence of message
+     *  \tparam BatchWriteHandler must conform to the BatchWriteHandler concept,
+     *          or be a completion token such as asio::use_future
+     *  \param msgs MessageRange of messages to send, the operation takes
+     *          ownership of the range
+     *  \param handler BatchWriteHandler
+     *  \param flags int flags applied to each message
+     *  \remark
+     *  The BatchWriteHandler concept has the following interface
+     *  struct BatchWriteHandler {
+     *      void operator()(const asio::error_code & ec,
+     *                      size_t messages_sent,
+     *                      size_t bytes_transferred);
+     *  }
+     *  \remark
+     *  Each message is sent as an independent message. As many messages as the
+     *  socket accepts without blocking are sent on each attempt, the remainder
+     *  are sent when the socket next becomes writable. The handler is invoked
+     *  once, after every message has been sent or an error occurs, with the
+     *  number of messages and bytes that were sent.
+     */
+    template<typename MessageRange,
+             typename BatchWriteHandler>
+    auto async_send_batch(MessageRange && msgs,
+                          BatchWriteHandler && handler,
+                          flags_type flags = 0) ->
+        detail::async_result_t<BatchWriteHandler, void(asio::error_code, size_t, size_t)>
+    {
+        return detail::async_initiate<void(asio::error_code, size_t, size_t), BatchWriteHandler>(
+                    initiate_send_batch<typename std::decay<MessageRange>::type>{ this }, handler,
+                    std::forward<MessageRange>(msgs), flags);
     }
 
     /** \brief Initiate shutdown of socket
@@ -681,6 +1109,152 @@ public:
         s.get_service().format(s.implementation, stm);
         return stm;
     }
+
+private:
+    // initiation function objects for the completion token based operations,
+    // each enqueues the op for the completion handler produced by the token.
+    // The operation's arguments are passed in with the handler, a lazy token
+    // holds copies of them until it starts the operation.
+    template<typename ConstBufferSequence>
+    struct initiate_send {
+        socket* self_;
+
+        template<typename WriteHandler>
+        void operator()(WriteHandler && handler, ConstBufferSequence const& buffers,
+                        flags_type flags) const {
+            using type = detail::send_buffer_op<ConstBufferSequence, typename std::decay<WriteHandler>::type>;
+            self_->get_service().template enqueue<type>(self_->implementation,
+                                                        detail::socket_service::op_type::write_op,
+                                                        std::forward<WriteHandler>(handler), buffers, flags);
+        }
+    };
+
+    // the op may outlive the call, libzmq releases the frames when it is done
+    // with them, possibly on one of its own threads
+    template<typename ConstBufferSequence>
+    struct initiate_send_nocopy {
+        socket* self_;
+
+        template<typename WriteHandler>
+        void operator()(WriteHandler && handler, ConstBufferSequence const& buffers,
+                        flags_type flags) const {
+            using type = detail::send_nocopy_buffer_op<ConstBufferSequence, typename std::decay<WriteHandler>::type>;
+            self_->get_service().template enqueue<type>(self_->implementation,
+                                                        detail::socket_service::op_type::write_op,
+                                                        std::forward<WriteHandler>(handler), buffers, flags,
+                                                        self_->get_io_service(),
+                                                        self_->get_service().get_strand(self_->implementation));
+        }
+    };
+
+    struct initiate_send_message {
+        socket* self_;
+
+        template<typename WriteHandler>
+        void operator()(WriteHandler && handler, message msg, flags_type flags) const {
+            using type = detail::send_op<typename std::decay<WriteHandler>::type>;
+            self_->get_service().template enqueue<type>(self_->implementation,
+                                                        detail::socket_service::op_type::write_op,
+                                                        std::forward<WriteHandler>(handler), std::move(msg), flags);
+        }
+    };
+
+    template<typename MessageVector>
+    struct initiate_send_parts {
+        socket* self_;
+
+        template<typename WriteHandler>
+        void operator()(WriteHandler && handler, MessageVector parts, flags_type flags) const {
+            using type = detail::send_multipart_op<MessageVector, typename std::decay<WriteHandler>::type>;
+            self_->get_service().template enqueue<type>(self_->implementation,
+                                                        detail::socket_service::op_type::write_op,
+                                                        std::forward<WriteHandler>(handler),
+                                                        std::move(parts), flags);
+        }
+    };
+
+    template<typename MessageRange>
+    struct initiate_send_batch {
+        socket* self_;
+
+        template<typename BatchWriteHandler>
+        void operator()(BatchWriteHandler && handler, MessageRange msgs, flags_type flags) const {
+            using type = detail::send_batch_op<MessageRange, typename std::decay<BatchWriteHandler>::type>;
+            self_->get_service().template enqueue<type>(self_->implementation,
+                                                        detail::socket_service::op_type::write_op,
+                                                        std::forward<BatchWriteHandler>(handler),
+                                                        std::move(msgs), flags);
+        }
+    };
+
+    template<typename MutableBufferSequence>
+    struct initiate_receive {
+        socket* self_;
+
+        template<typename ReadHandler>
+        void operator()(ReadHandler && handler, MutableBufferSequence const& buffers,
+                        flags_type flags) const {
+            using type = detail::receive_buffer_op<MutableBufferSequence, typename std::decay<ReadHandler>::type>;
+            self_->get_service().template enqueue<type>(self_->implementation,
+                                                        detail::socket_service::op_type::read_op,
+                                                        std::forward<ReadHandler>(handler), buffers, flags);
+        }
+    };
+
+    template<typename MutableBufferSequence>
+    struct initiate_receive_more {
+        socket* self_;
+
+        template<typename ReadMoreHandler>
+        void operator()(ReadMoreHandler && handler, MutableBufferSequence const& buffers,
+                        flags_type flags) const {
+            using type = detail::receive_more_buffer_op<MutableBufferSequence, typename std::decay<ReadMoreHandler>::type>;
+            self_->get_service().template enqueue<type>(self_->implementation,
+                                                        detail::socket_service::op_type::read_op,
+                                                        std::forward<ReadMoreHandler>(handler), buffers, flags);
+        }
+    };
+
+    // vec is the caller's, which must outlive the operation
+    template<typename MessageVector>
+    struct initiate_receive_multipart {
+        socket* self_;
+
+        template<typename ReadHandler>
+        void operator()(ReadHandler && handler, MessageVector* vec, flags_type flags) const {
+            using type = detail::receive_multipart_op<MessageVector, typename std::decay<ReadHandler>::type>;
+            self_->get_service().template enqueue<type>(self_->implementation,
+                                                        detail::socket_service::op_type::read_op,
+                                                        std::forward<ReadHandler>(handler), *vec, flags);
+        }
+    };
+
+    // vec is the caller's, which must outlive the operation
+    struct initiate_receive_batch {
+        socket* self_;
+
+        template<typename ReadHandler>
+        void operator()(ReadHandler && handler, message_vector* vec, size_t max_msgs,
+                        flags_type flags) const {
+            using type = detail::receive_batch_op<typename std::decay<ReadHandler>::type>;
+            self_->get_service().template enqueue<type>(self_->implementation,
+                                                        detail::socket_service::op_type::read_op,
+                                                        std::forward<ReadHandler>(handler), *vec,
+                                                        max_msgs, flags);
+        }
+    };
+
+    struct initiate_receive_message {
+        socket* self_;
+
+        template<typename MessageHandler>
+        void operator()(MessageHandler && handler, flags_type flags) const {
+            using type = detail::receive_message_op<typename std::decay<MessageHandler>::type>;
+            self_->get_service().template enqueue<type>(self_->implementation,
+                                                        detail::socket_service::op_type::read_op,
+                                                        std::forward<MessageHandler>(handler), flags);
+        }
+    };
 };
 AZMQ_V1_INLINE_NAMESPACE_END
 
@@ -699,6 +1273,12 @@ namespace detail {
             static_assert(sizeof(*this) == sizeof(socket), "Specialized socket must not have any specific data members");
         }
 
+        specialized_socket(asio::io_service::strand & strand)
+            : Base(strand, Type)
+        {
+            static_assert(sizeof(*this) == sizeof(socket), "Specialized socket must not have any specific data members");
+        }
+
         specialized_socket(specialized_socket&& op)
             : Base(std::move(op))
         {}
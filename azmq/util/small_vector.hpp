@@ -0,0 +1,235 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_SMALL_VECTOR_HPP_
+#define AZMQ_SMALL_VECTOR_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace azmq {
+namespace util {
+/** \brief Sequence container with room for N elements inline, only the
+ *  (N+1)th element moves the contents to the heap.
+ *  \remark A subset of the std::vector interface. Unlike std::vector, moving
+ *  a small_vector whose elements are inline moves each element, and
+ *  iterators are invalidated by a move.
+ */
+template<typename T, std::size_t N>
+class small_vector {
+    static_assert(N > 0, "small_vector needs inline capacity");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = T const&;
+    using pointer = T*;
+    using const_pointer = T const*;
+    using iterator = T*;
+    using const_iterator = T const*;
+
+    small_vector() noexcept
+        : data_(inline_data())
+        , size_(0)
+        , capacity_(N)
+    { }
+
+    template<typename InputIterator,
+             typename = typename std::enable_if<
+                 !std::is_integral<InputIterator>::value>::type>
+    small_vector(InputIterator first, InputIterator last)
+        : small_vector()
+    {
+        for (; first != last; ++first)
+            emplace_back(*first);
+    }
+
+    small_vector(std::initializer_list<T> il)
+        : small_vector(il.begin(), il.end())
+    { }
+
+    small_vector(small_vector const& rhs)
+        : small_vector(rhs.begin(), rhs.end())
+    { }
+
+    small_vector(small_vector && rhs) noexcept(std::is_nothrow_move_constructible<T>::value)
+        : small_vector()
+    { take(rhs); }
+
+    ~small_vector() {
+        clear();
+        release();
+    }
+
+    small_vector & operator=(small_vector const& rhs) {
+        if (this != &rhs) {
+            clear();
+            reserve(rhs.size());
+            for (auto const& v : rhs)
+                emplace_back(v);
+        }
+        return *this;
+    }
+
+    small_vector & operator=(small_vector && rhs) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        if (this != &rhs) {
+            clear();
+            release();
+            data_ = inline_data();
+            capacity_ = N;
+            take(rhs);
+        }
+        return *this;
+    }
+
+    iterator begin() noexcept { return data_; }
+    iterator end() noexcept { return data_ + size_; }
+    const_iterator begin() const noexcept { return data_; }
+    const_iterator end() const noexcept { return data_ + size_; }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    size_type size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    size_type capacity() const noexcept { return capacity_; }
+    static constexpr size_type inline_capacity() { return N; }
+
+    /** \brief true while the elements are held inline */
+    bool is_inline() const noexcept { return data_ == inline_data(); }
+
+    T* data() noexcept { return data_; }
+    T const* data() const noexcept { return data_; }
+
+    reference operator[](size_type i) noexcept { assert(i < size_); return data_[i]; }
+    const_reference operator[](size_type i) const noexcept { assert(i < size_); return data_[i]; }
+    reference front() noexcept { return (*this)[0]; }
+    const_reference front() const noexcept { return (*this)[0]; }
+    reference back() noexcept { return (*this)[size_ - 1]; }
+    const_reference back() const noexcept { return (*this)[size_ - 1]; }
+
+    void reserve(size_type n) {
+        if (n > capacity_)
+            grow(n);
+    }
+
+    template<typename... Args>
+    reference emplace_back(Args&&... args) {
+        if (size_ == capacity_)
+            return grow_emplace_back(std::forward<Args>(args)...);
+        auto p = ::new (static_cast<void*>(data_ + size_)) T(std::forward<Args>(args)...);
+        ++size_;
+        return *p;
+    }
+
+    void push_back(T const& v) { emplace_back(v); }
+    void push_back(T && v) { emplace_back(std::move(v)); }
+
+    void pop_back() noexcept {
+        assert(size_);
+        data_[--size_].~T();
+    }
+
+    /** \brief destroy the elements, heap storage is kept for reuse */
+    void clear() noexcept {
+        while (size_)
+            pop_back();
+    }
+
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type inline_[N];
+    T* data_;
+    size_type size_;
+    size_type capacity_;
+
+    T* inline_data() noexcept { return reinterpret_cast<T*>(inline_); }
+    T const* inline_data() const noexcept { return reinterpret_cast<T const*>(inline_); }
+
+    void grow(size_type n) {
+        auto p = static_cast<T*>(::operator new(n * sizeof(T)));
+        try {
+            adopt(p, n);
+        } catch (...) {
+            ::operator delete(p);
+            throw;
+        }
+    }
+
+    // the new element is constructed in the new storage before the old
+    // elements are moved, args may refer to one of them
+    template<typename... Args>
+    reference grow_emplace_back(Args&&... args) {
+        auto n = 2 * capacity_;
+        auto p = static_cast<T*>(::operator new(n * sizeof(T)));
+        try {
+            ::new (static_cast<void*>(p + size_)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            ::operator delete(p);
+            throw;
+        }
+        try {
+            adopt(p, n);
+        } catch (...) {
+            p[size_].~T();
+            ::operator delete(p);
+            throw;
+        }
+        return data_[size_++];
+    }
+
+    // moves the elements to p, of capacity n, and releases the old storage,
+    // p is left to the caller if a move throws
+    void adopt(T* p, size_type n) {
+        size_type i = 0;
+        try {
+            for (; i != size_; ++i)
+                ::new (static_cast<void*>(p + i)) T(std::move_if_noexcept(data_[i]));
+        } catch (...) {
+            while (i)
+                p[--i].~T();
+            throw;
+        }
+        auto sz = size_;
+        clear();
+        release();
+        data_ = p;
+        size_ = sz;
+        capacity_ = n;
+    }
+
+    void release() noexcept {
+        if (!is_inline())
+            ::operator delete(data_);
+    }
+
+    // rhs is left empty, with inline storage
+    void take(small_vector & rhs) {
+        if (!rhs.is_inline()) {
+            data_ = rhs.data_;
+            size_ = rhs.size_;
+            capacity_ = rhs.capacity_;
+            rhs.data_ = rhs.inline_data();
+            rhs.size_ = 0;
+            rhs.capacity_ = N;
+            return;
+        }
+        for (auto & v : rhs)
+            emplace_back(std::move(v));
+        rhs.clear();
+    }
+};
+} // namespace util
+} // namespace azmq
+#endif // AZMQ_SMALL_VECTOR_HPP_
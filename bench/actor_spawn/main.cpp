@@ -0,0 +1,97 @@
+// Spawns actors, exchanges one message with each and joins them, comparing
+// a dedicated thread per actor (actor::spawn) with actors multiplexed over a
+// thread pool (actor::spawn_on). Runs in batches so that a bounded number of
+// actors is alive at any time.
+#include <azmq/actor.hpp>
+
+#include <asio/io_service.hpp>
+#include <asio/buffer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    void echo_once(azmq::socket & ss) {
+        ss.async_receive([&ss](asio::error_code const& ec, azmq::message & msg, size_t) {
+            if (!ec)
+                ss.send(msg);
+        });
+    }
+
+    struct result {
+        double spawn;   // seconds spent in spawn calls
+        double total;   // seconds to spawn, ping and join
+    };
+
+    template<typename Spawn>
+    result run(size_t count, size_t batch, Spawn spawn) {
+        auto const ping = asio::buffer("ping");
+        clock_type::duration spawning{ 0 };
+        auto start = clock_type::now();
+        for (size_t done = 0; done < count; done += batch) {
+            std::vector<azmq::socket> peers;
+            peers.reserve(batch);
+            auto t = clock_type::now();
+            for (size_t i = 0; i != batch; ++i)
+                peers.emplace_back(spawn());
+            spawning += clock_type::now() - t;
+            for (auto & p : peers)
+                p.send(ping);
+            azmq::message msg;
+            for (auto & p : peers)
+                p.receive(msg);
+            // destroying the peers joins the actors
+        }
+        std::chrono::duration<double> total = clock_type::now() - start;
+        std::chrono::duration<double> spawn_secs = spawning;
+        return { spawn_secs.count(), total.count() };
+    }
+
+    void report(std::string const& what, size_t count, result r) {
+        std::cout << what << " actors=" << count
+                  << " spawn usec/actor=" << r.spawn * 1e6 / count
+                  << " total usec/actor=" << r.total * 1e6 / count
+                  << " actors/s=" << count / r.total << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t divisor = argc > 1 ? std::max(1, std::atoi(argv[1])) : 1;
+    size_t count = 10000 / divisor;
+    size_t batch = 100;
+
+    asio::io_service ios;
+    {
+        azmq::actor::pool pool;
+        report("spawn_on pool threads=" + std::to_string(pool.size()), count,
+               run(count, batch, [&] {
+                   return azmq::actor::spawn_on(pool, ios, false, echo_once);
+               }));
+
+        // pipes created ahead of time on the pool, and replaced while the
+        // batch is pinged and joined
+        pool.reserve(batch);
+        report("spawn_on pool reserve=" + std::to_string(batch), count,
+               run(count, batch, [&] {
+                   return azmq::actor::spawn_on(pool, echo_once);
+               }));
+    }
+
+    // a thread, io_service and pipe per actor, so fewer of them
+    count /= 20;
+    batch /= 10;
+    report("spawn thread per actor", count,
+           run(count, batch, [&] {
+               return azmq::actor::spawn(ios, [](azmq::socket & ss) {
+                   echo_once(ss);
+                   ss.get_io_service().run();
+               });
+           }));
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_BENCH_BENCH_HPP_
+#define AZMQ_BENCH_BENCH_HPP_
+
+#include <azmq/socket.hpp>
+
+#include <zmq.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// Shared plumbing for the throughput and latency benchmarks
+namespace bench {
+    using clock_type = std::chrono::steady_clock;
+
+    enum class mode { sync, async, raw };
+
+    inline char const* to_string(mode m) {
+        switch (m) {
+        case mode::sync: return "sync";
+        case mode::async: return "async";
+        default: return "raw";
+        }
+    }
+
+    inline std::vector<mode> modes() {
+        return { mode::raw, mode::sync, mode::async };
+    }
+
+    // client sends first, server receives
+    struct pattern {
+        char const* name;
+        int client;
+        int server;
+        bool bidirectional;
+    };
+
+    inline std::vector<pattern> patterns() {
+        return {
+            { "PUSH/PULL", ZMQ_PUSH, ZMQ_PULL, false },
+            { "PUB/SUB", ZMQ_PUB, ZMQ_SUB, false },
+            { "REQ/REP", ZMQ_REQ, ZMQ_REP, true },
+            { "DEALER/ROUTER", ZMQ_DEALER, ZMQ_ROUTER, true }
+        };
+    }
+
+    inline std::vector<std::string> transports() {
+#ifdef _WIN32
+        return { "inproc", "tcp" };
+#else
+        return { "inproc", "ipc", "tcp" };
+#endif
+    }
+
+    inline std::vector<size_t> sizes() {
+        return { 16, 256, 4096, 64 * 1024, 1024 * 1024 };
+    }
+
+#ifndef _WIN32
+    // libzmq only removes ipc files when the context terminates, which the
+    // shared azmq context never does
+    struct ipc_paths {
+        std::vector<std::string> paths_;
+
+        ~ipc_paths() {
+            for (auto const& p : paths_)
+                unlink(p.c_str());
+        }
+    };
+#endif
+
+    // bind address for transport, unique within the process
+    inline std::string bind_address(std::string const& transport) {
+        static int id = 0;
+        std::ostringstream stm;
+        if (transport == "tcp") {
+            stm << "tcp://127.0.0.1:*";
+        } else if (transport == "ipc") {
+#ifndef _WIN32
+            static ipc_paths created;
+            std::ostringstream path;
+            path << "/tmp/azmq_bench_" << getpid() << '_' << id++;
+            created.paths_.push_back(path.str());
+            stm << "ipc://" << path.str();
+#endif
+        } else {
+            stm << "inproc://azmq_bench_" << id++;
+        }
+        return stm.str();
+    }
+
+    // message count for a run, scaled down for large messages and by the
+    // divisor passed on the command line
+    inline size_t message_count(size_t size, size_t budget_bytes,
+                                size_t min_count, size_t max_count,
+                                size_t divisor) {
+        auto n = std::max(min_count, std::min(max_count, budget_bytes / size));
+        return std::max<size_t>(1, n / divisor);
+    }
+
+    inline size_t divisor(int argc, char** argv) {
+        return argc > 1 ? std::max(1, std::atoi(argv[1])) : 1;
+    }
+
+    inline void configure(azmq::socket & s) {
+        int type = 0;
+        size_t len = sizeof(type);
+        zmq_getsockopt(s.native_handle(), ZMQ_TYPE, &type, &len);
+        if (type == ZMQ_PUB || type == ZMQ_SUB) {
+            // do not drop messages while the subscriber lags behind
+            s.set_option(azmq::socket::snd_hwm(0));
+            s.set_option(azmq::socket::rcv_hwm(0));
+        }
+        if (type == ZMQ_SUB)
+            s.set_option(azmq::socket::subscribe(""));
+    }
+
+    inline void drain(void* s, long timeout_ms) {
+        zmq_pollitem_t item = { s, 0, ZMQ_POLLIN, 0 };
+        while (zmq_poll(&item, 1, timeout_ms) > 0) {
+            zmq_msg_t msg;
+            zmq_msg_init(&msg);
+            zmq_msg_recv(&msg, s, ZMQ_DONTWAIT);
+            zmq_msg_close(&msg);
+        }
+    }
+
+    // send probes until one arrives so slow joiners (PUB/SUB, tcp connect)
+    // do not distort the first samples, then discard stray probes
+    inline void warm_up(azmq::socket & tx, azmq::socket & rx) {
+        auto t = tx.native_handle();
+        auto r = rx.native_handle();
+        zmq_pollitem_t item = { r, 0, ZMQ_POLLIN, 0 };
+        do {
+            zmq_send(t, "", 0, ZMQ_DONTWAIT);
+        } while (zmq_poll(&item, 1, 10) <= 0);
+        drain(r, 50);
+    }
+
+    inline double percentile(std::vector<double> const& sorted, double p) {
+        if (sorted.empty())
+            return 0;
+        auto idx = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(idx, sorted.size() - 1)];
+    }
+
+    // one flat JSON object
+    class record {
+    public:
+        record & add(char const* key, std::string const& value) {
+            next(key) << '"' << value << '"';
+            return *this;
+        }
+
+        record & add(char const* key, char const* value) {
+            return add(key, std::string(value));
+        }
+
+        template<typename T>
+        record & add(char const* key, T value) {
+            next(key) << value;
+            return *this;
+        }
+
+        std::string str() const { return stm_.str() + "}"; }
+
+    private:
+        std::ostringstream stm_;
+        bool first_ = true;
+
+        std::ostream & next(char const* key) {
+            stm_ << (first_ ? "{" : ", ") << '"' << key << "\": ";
+            first_ = false;
+            return stm_;
+        }
+    };
+
+    // emits records as a JSON array on stdout
+    class json_writer {
+    public:
+        json_writer() { std::cout << "[" << std::endl; }
+        ~json_writer() { std::cout << std::endl << "]" << std::endl; }
+
+        void write(record const& r) {
+            std::cout << (first_ ? "  " : ",\n  ") << r.str() << std::flush;
+            first_ = false;
+        }
+
+    private:
+        bool first_ = true;
+    };
+} // namespace bench
+#endif // AZMQ_BENCH_BENCH_HPP_
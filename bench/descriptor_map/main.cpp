@@ -0,0 +1,71 @@
+// Churns 10k idle sockets through reactor registration and unregistration
+// (async_receive with nothing to read, then cancel) from 1, 2, 4 and 8
+// threads sharing one io_service.
+#include <azmq/socket.hpp>
+
+#include <asio/io_service.hpp>
+#include <asio/buffer.hpp>
+
+#include <zmq.h>
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    const size_t socket_count = 10000;
+    const size_t rounds = 20;
+
+    struct ignore {
+        void operator()(asio::error_code const&, size_t) const { }
+    };
+}
+
+int main() {
+    auto ctx = azmq::detail::context_ops::get_context();
+    zmq_ctx_set(ctx.get(), ZMQ_MAX_SOCKETS, socket_count + 100);
+
+    asio::io_service ios;
+    std::vector<std::unique_ptr<azmq::socket>> sockets;
+    for (size_t i = 0; i < socket_count; ++i) {
+        sockets.emplace_back(new azmq::socket(ios, ZMQ_PAIR));
+        // nothing ever arrives, every async_receive goes to the reactor
+        sockets.back()->set_option(azmq::socket::allow_speculative(false));
+    }
+
+    // keep poll() from stopping the io_service when it briefly runs dry
+    asio::io_service::work work(ios);
+    std::array<char, 16> buf;
+    for (size_t threads : { 1u, 2u, 4u, 8u }) {
+        auto start = clock_type::now();
+        std::vector<std::thread> ts;
+        for (size_t t = 0; t < threads; ++t) {
+            ts.emplace_back([&, t] {
+                auto first = socket_count * t / threads;
+                auto last = socket_count * (t + 1) / threads;
+                for (size_t r = 0; r < rounds; ++r) {
+                    for (auto i = first; i != last; ++i)
+                        sockets[i]->async_receive(asio::buffer(buf), ignore());
+                    for (auto i = first; i != last; ++i)
+                        sockets[i]->cancel();
+                    // run the aborted reactor waits so sockets go idle again
+                    ios.poll();
+                }
+            });
+        }
+        for (auto & t : ts)
+            t.join();
+        ios.poll();
+
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+        std::cout << "threads=" << threads
+                  << " sockets=" << socket_count
+                  << " registrations/s=" << socket_count * rounds / elapsed.count() << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Counts the heap allocations made per ROUTER/DEALER request and reply when
+// the frames are collected into a message_vector or a small_message_vector.
+// The router receives identity, delimiter, header and body with
+// receive_more and sends them straight back, or replies through an
+// envelope, and the dealer receives the reply the same way. A fresh container is used for every message, as a service
+// handling requests independently would. Payloads are small enough to be
+// stored inline by libzmq, so the container is the main source of
+// allocations on the azmq side; allocations inside libzmq are counted too.
+#include <azmq/socket.hpp>
+
+#include <asio/io_service.hpp>
+#include <asio/buffer.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+namespace {
+    std::atomic<size_t> allocations{ 0 };
+}
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (auto p = std::malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    // the router either sends the received parts straight back, or splits
+    // them with an envelope and replies to it
+    template<typename MessageVector>
+    void echo(azmq::socket & router) {
+        MessageVector in;
+        router.receive_more(in, 0);
+        router.send(in);
+    }
+
+    struct echo_envelope { };
+
+    template<>
+    void echo<echo_envelope>(azmq::socket & router) {
+        azmq::small_message_vector in;
+        router.receive_more(in, 0);
+        azmq::envelope env(std::move(in));
+        router.reply(env, env.body());
+    }
+
+    template<typename Router, typename MessageVector>
+    void run(std::string const& what, size_t count) {
+        asio::io_service ios;
+        azmq::router_socket router(ios);
+        router.bind("inproc://bench-envelope-" + what);
+        azmq::dealer_socket dealer(ios);
+        dealer.connect("inproc://bench-envelope-" + what);
+
+        std::array<asio::const_buffer, 3> request = {{
+            asio::buffer("", 0),
+            asio::buffer("header"),
+            asio::buffer("body")
+        }};
+
+        auto round_trip = [&] {
+            dealer.send(request);
+            echo<Router>(router);
+            MessageVector reply;
+            dealer.receive_more(reply, 0);
+            if (reply.size() != 3)
+                std::abort();
+        };
+
+        // warm up libzmq's pipes and queues
+        for (size_t i = 0; i < 1000; ++i)
+            round_trip();
+
+        auto before = allocations.load();
+        auto start = clock_type::now();
+        for (size_t i = 0; i < count; ++i)
+            round_trip();
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+        auto allocs = allocations.load() - before;
+
+        std::cout << what << " requests=" << count
+                  << " allocs/request=" << static_cast<double>(allocs) / count
+                  << " nsec/request=" << elapsed.count() * 1e9 / count << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::atoi(argv[1]) : 100000;
+    run<azmq::message_vector, azmq::message_vector>("message_vector", count);
+    run<azmq::small_message_vector, azmq::small_message_vector>("small_message_vector", count);
+    run<echo_envelope, azmq::small_message_vector>("envelope_reply", count);
+    return 0;
+}
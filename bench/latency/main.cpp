@@ -0,0 +1,233 @@
+// Echoes messages from client to server and back and reports round trip
+// time percentiles and round trips/s for every transport, pattern, size and
+// mode. Unidirectional patterns use a second socket pair for the reply.
+//
+// usage: bench_latency [divisor]   (divides message counts for quick runs)
+#include "../bench.hpp"
+
+#include <asio/io_service.hpp>
+#include <asio/buffer.hpp>
+
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct echo_pair {
+        asio::io_service ios_c;
+        asio::io_service ios_s;
+        std::unique_ptr<azmq::socket> client;
+        std::unique_ptr<azmq::socket> server;
+        std::unique_ptr<azmq::socket> server_reply;
+        std::unique_ptr<azmq::socket> client_reply;
+
+        azmq::socket & reply_tx() { return server_reply ? *server_reply : *server; }
+        azmq::socket & reply_rx() { return client_reply ? *client_reply : *client; }
+
+        echo_pair(bench::pattern const& p, std::string const& transport) {
+            server.reset(new azmq::socket(ios_s, p.server));
+            bench::configure(*server);
+            server->bind(bench::bind_address(transport));
+            client.reset(new azmq::socket(ios_c, p.client));
+            bench::configure(*client);
+            client->connect(server->endpoint());
+
+            if (!p.bidirectional) {
+                client_reply.reset(new azmq::socket(ios_c, p.server));
+                bench::configure(*client_reply);
+                client_reply->bind(bench::bind_address(transport));
+                server_reply.reset(new azmq::socket(ios_s, p.client));
+                bench::configure(*server_reply);
+                server_reply->connect(client_reply->endpoint());
+                bench::warm_up(*client, *server);
+                bench::warm_up(*server_reply, *client_reply);
+            }
+        }
+    };
+
+    // server side, forwards every frame back to the client
+    struct echo_state {
+        azmq::socket & rx_;
+        azmq::socket & tx_;
+        size_t remaining_;
+    };
+
+    struct echo_sent {
+        echo_state & s_;
+        bool more_;
+
+        void operator()(asio::error_code const& ec, size_t);
+    };
+
+    struct async_echo {
+        echo_state & s_;
+
+        void operator()(asio::error_code const& ec, azmq::message & msg, size_t) {
+            if (ec) return;
+            auto more = msg.more();
+            s_.tx_.async_send(msg, echo_sent{ s_, more }, more ? ZMQ_SNDMORE : 0);
+        }
+    };
+
+    void echo_sent::operator()(asio::error_code const& ec, size_t) {
+        if (ec) return;
+        if (!more_ && !--s_.remaining_)
+            return;
+        s_.rx_.async_receive(async_echo{ s_ });
+    }
+
+    void serve(bench::mode m, echo_pair & e, size_t count) {
+        auto & rx = *e.server;
+        auto & tx = e.reply_tx();
+        switch (m) {
+        case bench::mode::raw: {
+                zmq_msg_t msg;
+                zmq_msg_init(&msg);
+                while (count) {
+                    zmq_msg_recv(&msg, rx.native_handle(), 0);
+                    auto more = zmq_msg_more(&msg);
+                    zmq_msg_send(&msg, tx.native_handle(), more ? ZMQ_SNDMORE : 0);
+                    if (!more)
+                        --count;
+                }
+                zmq_msg_close(&msg);
+            }
+            break;
+        case bench::mode::sync: {
+                azmq::message msg;
+                while (count) {
+                    rx.receive(msg);
+                    auto more = msg.more();
+                    tx.send(msg, more ? ZMQ_SNDMORE : 0);
+                    if (!more)
+                        --count;
+                }
+            }
+            break;
+        case bench::mode::async: {
+                echo_state s{ rx, tx, count };
+                rx.async_receive(async_echo{ s });
+                e.ios_s.run();
+            }
+            break;
+        }
+    }
+
+    // client side, one round trip at a time
+    struct async_client {
+        azmq::socket & tx_;
+        azmq::socket & rx_;
+        asio::const_buffers_1 const& buf_;
+        std::vector<double> & samples_;
+        size_t & remaining_;
+        bench::clock_type::time_point start_;
+
+        void next() {
+            if (!remaining_--)
+                return;
+            start_ = bench::clock_type::now();
+            tx_.async_send(buf_, [this](asio::error_code const& ec, size_t) {
+                if (!ec) receive();
+            });
+        }
+
+        void receive() {
+            rx_.async_receive([this](asio::error_code const& ec, azmq::message & msg, size_t) {
+                if (ec) return;
+                if (msg.more())
+                    return receive();
+                std::chrono::duration<double, std::micro> rtt = bench::clock_type::now() - start_;
+                samples_.push_back(rtt.count());
+                next();
+            });
+        }
+    };
+
+    void request(bench::mode m, echo_pair & e, std::vector<char> const& payload,
+                 size_t count, std::vector<double> & samples) {
+        auto & tx = *e.client;
+        auto & rx = e.reply_rx();
+        auto const buf = asio::buffer(payload);
+        switch (m) {
+        case bench::mode::raw: {
+                zmq_msg_t reply;
+                zmq_msg_init(&reply);
+                for (size_t i = 0; i < count; ++i) {
+                    auto start = bench::clock_type::now();
+                    zmq_msg_t msg;
+                    zmq_msg_init_size(&msg, payload.size());
+                    std::memcpy(zmq_msg_data(&msg), payload.data(), payload.size());
+                    zmq_msg_send(&msg, tx.native_handle(), 0);
+                    do {
+                        zmq_msg_recv(&reply, rx.native_handle(), 0);
+                    } while (zmq_msg_more(&reply));
+                    std::chrono::duration<double, std::micro> rtt = bench::clock_type::now() - start;
+                    samples.push_back(rtt.count());
+                }
+                zmq_msg_close(&reply);
+            }
+            break;
+        case bench::mode::sync: {
+                azmq::message reply;
+                for (size_t i = 0; i < count; ++i) {
+                    auto start = bench::clock_type::now();
+                    tx.send(buf);
+                    do {
+                        rx.receive(reply);
+                    } while (reply.more());
+                    std::chrono::duration<double, std::micro> rtt = bench::clock_type::now() - start;
+                    samples.push_back(rtt.count());
+                }
+            }
+            break;
+        case bench::mode::async: {
+                auto remaining = count;
+                async_client c{ tx, rx, buf, samples, remaining, bench::clock_type::now() };
+                c.next();
+                e.ios_c.run();
+            }
+            break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    auto div = bench::divisor(argc, argv);
+    bench::json_writer out;
+
+    for (auto const& transport : bench::transports()) {
+        for (auto const& p : bench::patterns()) {
+            for (auto size : bench::sizes()) {
+                auto count = bench::message_count(size, 16 * 1024 * 1024, 100, 10000, div);
+                auto warm = std::max<size_t>(1, count / 10);
+                std::vector<char> payload(size, 'x');
+                for (auto m : bench::modes()) {
+                    echo_pair e(p, transport);
+                    std::thread server([&] { serve(m, e, warm + count); });
+
+                    std::vector<double> samples;
+                    samples.reserve(warm + count);
+                    auto start = bench::clock_type::now();
+                    request(m, e, payload, warm + count, samples);
+                    std::chrono::duration<double> elapsed = bench::clock_type::now() - start;
+                    server.join();
+
+                    samples.erase(samples.begin(), samples.begin() + warm);
+                    std::sort(samples.begin(), samples.end());
+                    out.write(bench::record().add("bench", "latency")
+                                             .add("transport", transport)
+                                             .add("pattern", p.name)
+                                             .add("size", size)
+                                             .add("mode", bench::to_string(m))
+                                             .add("round_trips", count)
+                                             .add("round_trips_per_sec", (warm + count) / elapsed.count())
+                                             .add("p50_us", bench::percentile(samples, 0.5))
+                                             .add("p99_us", bench::percentile(samples, 0.99))
+                                             .add("p999_us", bench::percentile(samples, 0.999)));
+                }
+            }
+        }
+    }
+    return 0;
+}
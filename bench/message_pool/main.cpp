@@ -0,0 +1,89 @@
+// Compares building messages with zmq_msg_init_size against taking them from
+// an azmq::message_pool, both in isolation and when the frames are sent over
+// inproc and dropped by a receiving thread.
+#include <azmq/socket.hpp>
+#include <azmq/message_pool.hpp>
+
+#include <asio/io_service.hpp>
+#include <asio/buffer.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    struct plain {
+        azmq::message get(size_t size) { return azmq::message(size); }
+    };
+
+    template<typename Source>
+    double build(Source & source, size_t size, size_t count) {
+        auto start = clock_type::now();
+        for (size_t i = 0; i < count; ++i) {
+            auto m = source.get(size);
+            static_cast<char*>(const_cast<void*>(m.data()))[0] = 'x';
+        }
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+        return elapsed.count();
+    }
+
+    // frames are released by the receiving thread, as they would be by a
+    // consumer of a PULL socket
+    template<typename Source>
+    double send(Source & source, azmq::socket & sender, void* receiver,
+                size_t size, size_t count) {
+        std::thread t([&] {
+            zmq_msg_t msg;
+            zmq_msg_init(&msg);
+            for (size_t i = 0; i < count; ++i)
+                if (zmq_msg_recv(&msg, receiver, 0) != static_cast<int>(size))
+                    std::abort();
+            zmq_msg_close(&msg);
+        });
+        auto start = clock_type::now();
+        for (size_t i = 0; i < count; ++i)
+            sender.send(source.get(size));
+        t.join();
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+        return elapsed.count();
+    }
+
+    void report(std::string const& what, size_t size, size_t count, double secs) {
+        std::cout << what << " size=" << size
+                  << " msgs=" << count
+                  << " nsec/msg=" << secs * 1e9 / count
+                  << " msgs/s=" << count / secs << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t divisor = argc > 1 ? std::max(1, std::atoi(argv[1])) : 1;
+
+    asio::io_service ios;
+    azmq::socket receiver(ios, ZMQ_PULL);
+    receiver.set_option(azmq::socket::rcv_hwm(0));
+    receiver.bind("inproc://bench_message_pool");
+    azmq::socket sender(ios, ZMQ_PUSH);
+    sender.set_option(azmq::socket::snd_hwm(0));
+    sender.connect("inproc://bench_message_pool");
+
+    plain p;
+    azmq::message_pool pool;
+    for (size_t size : { 64u, 256u, 1024u, 2000u, 4096u }) {
+        auto count = 1000000 / divisor;
+        build(pool, size, count / 10);
+
+        report("build malloc", size, count, build(p, size, count));
+        report("build pool", size, count, build(pool, size, count));
+
+        count /= 4;
+        report("send malloc", size, count, send(p, sender, receiver.native_handle(), size, count));
+        report("send pool", size, count, send(pool, sender, receiver.native_handle(), size, count));
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Compares azmq::proxy against a forwarder written the way one had to be
+// before it, an async_receive_message per frame with a blocking send of each
+// frame from the handler. Both forward three part messages from a PUSH
+// client through PULL/PUSH sockets on an io_service run by their own thread
+// to a PULL server.
+#include <azmq/proxy.hpp>
+
+#include <asio/io_service.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    struct forwarder {
+        azmq::socket & in;
+        azmq::socket & out;
+
+        void operator()(asio::error_code const& ec, azmq::message & msg, size_t) {
+            if (ec)
+                return;
+            out.send(msg, msg.more() ? ZMQ_SNDMORE : 0);
+            in.async_receive(forwarder{ in, out });
+        }
+    };
+
+    double run(std::string const& what, size_t count, size_t size) {
+        asio::io_service ios;
+        azmq::pull_socket frontend(ios);
+        frontend.bind("inproc://bench-frontend");
+        azmq::push_socket backend(ios);
+        backend.bind("inproc://bench-backend");
+
+        asio::io_service client_ios;
+        azmq::push_socket client(client_ios);
+        client.connect("inproc://bench-frontend");
+        azmq::pull_socket server(client_ios);
+        server.connect("inproc://bench-backend");
+
+        std::unique_ptr<azmq::proxy> p;
+        if (what == "proxy")
+            p.reset(new azmq::proxy(std::move(frontend), std::move(backend)));
+        else
+            frontend.async_receive(forwarder{ frontend, backend });
+
+        asio::io_service::work work(ios);
+        std::thread t([&] { ios.run(); });
+
+        std::string payload(size, 'x');
+        auto start = clock_type::now();
+        std::thread sender([&] {
+            for (size_t i = 0; i < count; ++i) {
+                client.send(azmq::message("header"), ZMQ_SNDMORE);
+                client.send(azmq::message("routing"), ZMQ_SNDMORE);
+                client.send(azmq::message(payload));
+            }
+        });
+
+        azmq::message msg;
+        for (size_t i = 0; i < 3 * count; ++i)
+            server.receive(msg);
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+        sender.join();
+        ios.stop();
+        t.join();
+        return elapsed.count();
+    }
+
+    void report(std::string const& what, size_t size, size_t count, double secs) {
+        std::cout << what << " size=" << size
+                  << " msgs=" << count
+                  << " usec/msg=" << secs * 1e6 / count
+                  << " msgs/s=" << count / secs << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+
+    for (size_t size : { 16u, 1024u }) {
+        for (auto what : { "forwarder", "proxy" })
+            report(what, size, count, run(what, count, size));
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Compares receiving a frame into a caller supplied buffer through an
+// intermediate azmq::message against receiving it directly with zmq_recv.
+//
+// A direct receive only asks the socket for ZMQ_RCVMORE when the caller
+// passes that flag. The direct+rcvmore row adds the lookup after every
+// receive to show what it costs, earlier results for the direct path were
+// taken with it on every call and so include that cost.
+#include <azmq/socket.hpp>
+
+#include <asio/io_service.hpp>
+#include <asio/buffer.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    // multi-element sequences take the message + buffer_copy path
+    std::array<asio::mutable_buffer, 2> via_message(std::vector<char> & buf) {
+        return {{ asio::buffer(buf), asio::mutable_buffer() }};
+    }
+
+    std::array<asio::mutable_buffer, 1> direct(std::vector<char> & buf) {
+        return {{ asio::buffer(buf) }};
+    }
+
+    template<typename MakeBuffers>
+    double run(azmq::socket & sender, azmq::socket & receiver,
+               std::vector<char> const& payload, std::vector<char> & buf,
+               size_t count, MakeBuffers make_buffers, bool check_more = false) {
+        auto bufs = make_buffers(buf);
+        azmq::socket::rcv_more more;
+        auto start = clock_type::now();
+        for (size_t i = 0; i < count; ++i) {
+            sender.send(asio::buffer(payload));
+            if (receiver.receive(bufs) != payload.size())
+                std::abort();
+            if (check_more) {
+                receiver.get_option(more);
+                if (more.value())
+                    std::abort();
+            }
+        }
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+        return elapsed.count();
+    }
+
+    void report(std::string const& path, size_t size, size_t count, double secs) {
+        std::cout << path << " size=" << size
+                  << " msgs=" << count
+                  << " usec/msg=" << secs * 1e6 / count
+                  << " MiB/s=" << size * count / secs / (1024 * 1024) << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string uri = argc > 1 ? argv[1] : "tcp://127.0.0.1:*";
+
+    asio::io_service ios;
+    azmq::socket receiver(ios, ZMQ_PAIR);
+    receiver.bind(uri);
+    azmq::socket sender(ios, ZMQ_PAIR);
+    sender.connect(receiver.endpoint());
+
+    for (size_t size : { 1024u, 64u * 1024u, 1024u * 1024u }) {
+        size_t count = size < 64 * 1024 ? 100000
+                                        : (size < 1024 * 1024 ? 10000 : 1000);
+        std::vector<char> payload(size, 'x');
+        std::vector<char> buf(size);
+
+        // warm up the connection
+        run(sender, receiver, payload, buf, count / 10, direct);
+
+        report("message", size, count, run(sender, receiver, payload, buf, count, via_message));
+        report("direct", size, count, run(sender, receiver, payload, buf, count, direct));
+        report("direct+rcvmore", size, count, run(sender, receiver, payload, buf, count, direct, true));
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+// Async REQ/REP ping-pong with and without sticky_registration. On Linux
+// the epoll calls made by the process are counted by interposing them; for
+// a full syscall breakdown run the benchmark under `strace -c -f`.
+#include <azmq/socket.hpp>
+
+#include <asio/io_service.hpp>
+#include <asio/buffer.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#ifdef __linux__
+#include <dlfcn.h>
+#include <sys/epoll.h>
+
+namespace {
+    std::atomic<unsigned long> epoll_ctl_calls{ 0 };
+    std::atomic<unsigned long> epoll_wait_calls{ 0 };
+}
+
+extern "C" int epoll_ctl(int epfd, int op, int fd, struct epoll_event* event) {
+    using fn_type = int (*)(int, int, int, struct epoll_event*);
+    static auto real = reinterpret_cast<fn_type>(dlsym(RTLD_NEXT, "epoll_ctl"));
+    ++epoll_ctl_calls;
+    return real(epfd, op, fd, event);
+}
+
+extern "C" int epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout) {
+    using fn_type = int (*)(int, struct epoll_event*, int, int);
+    static auto real = reinterpret_cast<fn_type>(dlsym(RTLD_NEXT, "epoll_wait"));
+    ++epoll_wait_calls;
+    return real(epfd, events, maxevents, timeout);
+}
+#endif
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    const size_t round_trips = 20000;
+
+    void run(std::string const& uri, int sticky_ms) {
+        asio::io_service ios;
+
+        azmq::socket server(ios, ZMQ_REP);
+        server.set_option(azmq::socket::sticky_registration(sticky_ms));
+        server.bind(uri);
+
+        azmq::socket client(ios, ZMQ_REQ);
+        client.set_option(azmq::socket::sticky_registration(sticky_ms));
+        client.connect(server.endpoint());
+
+        auto const snd_buf = asio::buffer("ping");
+        std::array<char, 8> server_buf;
+        std::array<char, 8> client_buf;
+        size_t replies = 0;
+
+        std::function<void()> serve = [&] {
+            server.async_receive(asio::buffer(server_buf), [&](asio::error_code const& ec, size_t) {
+                if (ec) return;
+                server.send(snd_buf);
+                serve();
+            });
+        };
+
+        std::function<void()> request = [&] {
+            client.send(snd_buf);
+            client.async_receive(asio::buffer(client_buf), [&](asio::error_code const& ec, size_t) {
+                if (ec) return;
+                if (++replies < round_trips)
+                    request();
+                else
+                    ios.stop();
+            });
+        };
+
+#ifdef __linux__
+        auto ctl_before = epoll_ctl_calls.load();
+        auto wait_before = epoll_wait_calls.load();
+#endif
+        auto start = clock_type::now();
+        serve();
+        request();
+        ios.run();
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+        std::cout << uri.substr(0, uri.find(':'))
+                  << " sticky_ms=" << sticky_ms
+                  << " round_trips=" << round_trips
+                  << " usec/rt=" << elapsed.count() * 1e6 / round_trips;
+#ifdef __linux__
+        std::cout << " epoll_ctl=" << epoll_ctl_calls - ctl_before
+                  << " epoll_wait=" << epoll_wait_calls - wait_before;
+#endif
+        std::cout << std::endl;
+    }
+}
+
+int main() {
+    for (auto uri : { "inproc://bench_reqrep", "tcp://127.0.0.1:*" }) {
+        run(uri, 0);
+        run(uri, 1000);
+    }
+    return 0;
+}
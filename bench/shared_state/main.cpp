@@ -0,0 +1,137 @@
+// Counts how often taking a mutable view of a received message copies its
+// payload. Compares libzmq's ZMQ_SHARED property, as used by
+// message::buffer(), with the pre 4.1 heuristic of reading the last two
+// bytes of zmq_msg_t and with unconditionally copying.
+#include <azmq/socket.hpp>
+
+#include <asio/io_service.hpp>
+#include <asio/buffer.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    bool zmq_shared(zmq_msg_t & msg) { return zmq_msg_get(&msg, ZMQ_SHARED) == 1; }
+
+    bool last_bytes(zmq_msg_t & msg) {
+        auto p = reinterpret_cast<uint8_t*>(&msg);
+        return (p[sizeof(zmq_msg_t) - 1] & 128) || p[sizeof(zmq_msg_t) - 2] == 104;
+    }
+
+    bool always(zmq_msg_t &) { return true; }
+
+    // receive count frames, copying each one the predicate calls shared
+    template<typename IsShared>
+    void run(std::string const& scenario, char const* method, void* receiver,
+             size_t count, IsShared is_shared) {
+        size_t copies = 0;
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
+        auto start = clock_type::now();
+        for (size_t i = 0; i < count; ++i) {
+            if (zmq_msg_recv(&msg, receiver, 0) < 0)
+                std::abort();
+            if (is_shared(msg)) {
+                zmq_msg_t tmp;
+                zmq_msg_init_size(&tmp, zmq_msg_size(&msg));
+                std::memcpy(zmq_msg_data(&tmp), zmq_msg_data(&msg), zmq_msg_size(&msg));
+                zmq_msg_move(&msg, &tmp);
+                zmq_msg_close(&tmp);
+                ++copies;
+            }
+            static_cast<char*>(zmq_msg_data(&msg))[0] = 'y';
+        }
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+        zmq_msg_close(&msg);
+        std::cout << scenario << " " << method
+                  << " msgs=" << count
+                  << " copies=" << copies
+                  << " nsec/msg=" << elapsed.count() * 1e9 / count << std::endl;
+    }
+
+    // message::buffer() on messages received through azmq
+    void run_azmq(std::string const& scenario, azmq::socket & receiver, size_t count) {
+        size_t copies = 0;
+        azmq::message msg;
+        auto start = clock_type::now();
+        for (size_t i = 0; i < count; ++i) {
+            receiver.receive(msg);
+            auto p = msg.data();
+            auto b = msg.buffer();
+            if (asio::buffer_cast<void const*>(b) != p)
+                ++copies;
+            asio::buffer_cast<char*>(b)[0] = 'y';
+        }
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+        std::cout << scenario << " message::buffer"
+                  << " msgs=" << count
+                  << " copies=" << copies
+                  << " nsec/msg=" << elapsed.count() * 1e9 / count << std::endl;
+    }
+
+    void fill(azmq::socket & sender, size_t size, size_t count) {
+        std::vector<char> payload(size, 'x');
+        auto const buf = asio::buffer(payload);
+        for (size_t i = 0; i < count; ++i)
+            sender.send(buf);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t divisor = argc > 1 ? std::max(1, std::atoi(argv[1])) : 1;
+    size_t count = 200000 / divisor;
+
+    asio::io_service ios;
+    for (size_t size : { 256u, 4096u }) {
+        // PUSH/PULL hands each frame to exactly one peer
+        {
+            auto scenario = "PUSH/PULL size=" + std::to_string(size);
+            azmq::socket pull(ios, ZMQ_PULL);
+            pull.set_option(azmq::socket::rcv_hwm(0));
+            pull.bind("inproc://bench_shared_state_push");
+            azmq::socket push(ios, ZMQ_PUSH);
+            push.set_option(azmq::socket::snd_hwm(0));
+            push.connect("inproc://bench_shared_state_push");
+
+            fill(push, size, count);
+            run(scenario, "ZMQ_SHARED", pull.native_handle(), count, zmq_shared);
+            fill(push, size, count);
+            run(scenario, "last_bytes", pull.native_handle(), count, last_bytes);
+            fill(push, size, count);
+            run(scenario, "always", pull.native_handle(), count, always);
+            fill(push, size, count);
+            run_azmq(scenario, pull, count);
+        }
+
+        // PUB shares each frame between its subscribers
+        {
+            auto scenario = "PUB/SUBx2 size=" + std::to_string(size);
+            azmq::socket pub(ios, ZMQ_PUB);
+            pub.set_option(azmq::socket::snd_hwm(0));
+            pub.bind("inproc://bench_shared_state_pub");
+            azmq::socket sub(ios, ZMQ_SUB);
+            azmq::socket other(ios, ZMQ_SUB);
+            for (auto s : { &sub, &other }) {
+                s->set_option(azmq::socket::rcv_hwm(0));
+                s->set_option(azmq::socket::subscribe(""));
+                s->connect("inproc://bench_shared_state_pub");
+            }
+
+            fill(pub, size, count);
+            run(scenario, "ZMQ_SHARED", sub.native_handle(), count, zmq_shared);
+            fill(pub, size, count);
+            run(scenario, "last_bytes", sub.native_handle(), count, last_bytes);
+            fill(pub, size, count);
+            run(scenario, "always", sub.native_handle(), count, always);
+            fill(pub, size, count);
+            run_azmq(scenario, sub, count);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Compares the default mutex protected socket against a socket opened on
+// a strand, with a hot PUSH/PULL pair driven by 1, 2, 4 and 8 io_service
+// threads.
+#include <azmq/socket.hpp>
+
+#include <asio/io_service.hpp>
+#include <asio/buffer.hpp>
+#include <asio/strand.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    const size_t message_count = 200000;
+    const size_t chains = 4;
+
+    struct state {
+        azmq::socket & sender_;
+        azmq::socket & receiver_;
+        asio::const_buffers_1 const snd_buf_ = asio::buffer("0123456789abcdef");
+        std::atomic<long> to_send_{ message_count };
+        std::atomic<long> to_receive_{ message_count };
+
+        state(azmq::socket & sender, azmq::socket & receiver)
+            : sender_(sender)
+            , receiver_(receiver)
+        { }
+    };
+
+    struct sender {
+        state & s_;
+
+        void operator()(asio::error_code const& ec, size_t) {
+            if (!ec) start();
+        }
+
+        void start() {
+            if (--s_.to_send_ >= 0)
+                s_.sender_.async_send(s_.snd_buf_, sender{ s_ });
+        }
+    };
+
+    struct receiver {
+        state & s_;
+        std::shared_ptr<std::array<char, 32>> buf_;
+
+        void operator()(asio::error_code const& ec, size_t) {
+            if (!ec) start();
+        }
+
+        void start() {
+            if (--s_.to_receive_ >= 0)
+                s_.receiver_.async_receive(asio::buffer(*buf_), receiver{ s_, buf_ });
+        }
+    };
+
+    double run(asio::io_service & ios, state & s, size_t threads,
+               std::function<void(std::function<void()>)> on_sender,
+               std::function<void(std::function<void()>)> on_receiver) {
+        auto start = clock_type::now();
+        for (size_t i = 0; i < chains; ++i) {
+            on_sender([&] { sender{ s }.start(); });
+            on_receiver([&] { receiver{ s, std::make_shared<std::array<char, 32>>() }.start(); });
+        }
+
+        std::vector<std::thread> ts;
+        for (size_t i = 0; i < threads; ++i)
+            ts.emplace_back([&] { ios.run(); });
+        for (auto & t : ts)
+            t.join();
+
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+        return elapsed.count();
+    }
+
+    void report(std::string const& mode, size_t threads, double secs) {
+        std::cout << mode << " threads=" << threads
+                  << " msgs=" << message_count
+                  << " msgs/s=" << message_count / secs << std::endl;
+    }
+
+    std::string subj(std::string const& mode, size_t threads) {
+        return "inproc://bench_socket_mode_" + mode + std::to_string(threads);
+    }
+}
+
+int main() {
+    for (size_t threads : { 1u, 2u, 4u, 8u }) {
+        {
+            asio::io_service ios;
+            azmq::socket receiver(ios, ZMQ_PULL);
+            receiver.bind(subj("mutex", threads));
+            azmq::socket sender(ios, ZMQ_PUSH);
+            sender.connect(subj("mutex", threads));
+
+            state s(sender, receiver);
+            auto direct = [](std::function<void()> f) { f(); };
+            report("mutex", threads, run(ios, s, threads, direct, direct));
+        }
+
+        {
+            asio::io_service ios;
+            asio::io_service::strand rs(ios);
+            asio::io_service::strand ss(ios);
+            azmq::socket receiver(rs, ZMQ_PULL);
+            receiver.bind(subj("strand", threads));
+            azmq::socket sender(ss, ZMQ_PUSH);
+            sender.connect(subj("strand", threads));
+
+            state s(sender, receiver);
+            report("strand", threads, run(ios, s, threads,
+                                          [&](std::function<void()> f) { ss.post(f); },
+                                          [&](std::function<void()> f) { rs.post(f); }));
+        }
+    }
+    return 0;
+}
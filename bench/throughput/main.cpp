@@ -0,0 +1,145 @@
+// Streams messages from client to server and reports msgs/s for every
+// transport, pattern, size and mode. REQ/REP is lock-step, its rate is the
+// round trip rate reported by bench_latency.
+//
+// usage: bench_throughput [divisor]   (divides message counts for quick runs)
+#include "../bench.hpp"
+
+#include <asio/io_service.hpp>
+#include <asio/buffer.hpp>
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct async_sender {
+        azmq::socket & s_;
+        asio::const_buffers_1 const& buf_;
+        size_t & remaining_;
+
+        void operator()(asio::error_code const& ec, size_t) {
+            if (!ec && remaining_--)
+                s_.async_send(buf_, async_sender(*this));
+        }
+    };
+
+    struct async_receiver {
+        azmq::socket & s_;
+        size_t & remaining_;
+
+        void operator()(asio::error_code const& ec, azmq::message & msg, size_t) {
+            if (ec) return;
+            if (!msg.more() && !--remaining_)
+                return;
+            s_.async_receive(async_receiver(*this));
+        }
+    };
+
+    void send_raw(void* s, std::vector<char> const& payload, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            zmq_msg_t msg;
+            zmq_msg_init_size(&msg, payload.size());
+            std::memcpy(zmq_msg_data(&msg), payload.data(), payload.size());
+            zmq_msg_send(&msg, s, 0);
+        }
+    }
+
+    void receive_raw(void* s, size_t count) {
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
+        while (count) {
+            zmq_msg_recv(&msg, s, 0);
+            if (!zmq_msg_more(&msg))
+                --count;
+        }
+        zmq_msg_close(&msg);
+    }
+
+    double run(bench::mode m, azmq::socket & tx, asio::io_service & ios_tx,
+               azmq::socket & rx, asio::io_service & ios_rx,
+               std::vector<char> const& payload, size_t count) {
+        auto const buf = asio::buffer(payload);
+        auto start = bench::clock_type::now();
+        std::thread sender([&] {
+            switch (m) {
+            case bench::mode::raw:
+                send_raw(tx.native_handle(), payload, count);
+                break;
+            case bench::mode::sync:
+                for (size_t i = 0; i < count; ++i)
+                    tx.send(buf);
+                break;
+            case bench::mode::async: {
+                    auto remaining = count;
+                    async_sender{ tx, buf, remaining }(asio::error_code(), 0);
+                    ios_tx.run();
+                }
+                break;
+            }
+        });
+
+        switch (m) {
+        case bench::mode::raw:
+            receive_raw(rx.native_handle(), count);
+            break;
+        case bench::mode::sync: {
+                azmq::message msg;
+                for (auto n = count; n; ) {
+                    rx.receive(msg);
+                    if (!msg.more())
+                        --n;
+                }
+            }
+            break;
+        case bench::mode::async: {
+                auto remaining = count;
+                rx.async_receive(async_receiver{ rx, remaining });
+                ios_rx.run();
+            }
+            break;
+        }
+        std::chrono::duration<double> elapsed = bench::clock_type::now() - start;
+        sender.join();
+        return elapsed.count();
+    }
+}
+
+int main(int argc, char** argv) {
+    auto div = bench::divisor(argc, argv);
+    bench::json_writer out;
+
+    for (auto const& transport : bench::transports()) {
+        for (auto const& p : bench::patterns()) {
+            if (p.client == ZMQ_REQ)
+                continue;
+            for (auto size : bench::sizes()) {
+                auto count = bench::message_count(size, 64 * 1024 * 1024, 200, 200000, div);
+                std::vector<char> payload(size, 'x');
+                for (auto m : bench::modes()) {
+                    asio::io_service ios_tx;
+                    asio::io_service ios_rx;
+                    azmq::socket rx(ios_rx, p.server);
+                    bench::configure(rx);
+                    rx.bind(bench::bind_address(transport));
+                    azmq::socket tx(ios_tx, p.client);
+                    bench::configure(tx);
+                    tx.connect(rx.endpoint());
+                    bench::warm_up(tx, rx);
+
+                    auto secs = run(m, tx, ios_tx, rx, ios_rx, payload, count);
+                    out.write(bench::record().add("bench", "throughput")
+                                             .add("transport", transport)
+                                             .add("pattern", p.name)
+                                             .add("size", size)
+                                             .add("mode", bench::to_string(m))
+                                             .add("msgs", count)
+                                             .add("seconds", secs)
+                                             .add("msgs_per_sec", count / secs)
+                                             .add("mib_per_sec", count * size / secs / (1024 * 1024)));
+                }
+            }
+        }
+    }
+    return 0;
+}
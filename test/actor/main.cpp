@@ -14,6 +14,9 @@
 #include <array>
 #include <thread>
 #include <iostream>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
 
 #define CATCH_CONFIG_MAIN
 #include "../catch.hpp"
@@ -66,3 +69,93 @@ TEST_CASE( "Async Send/Receive", "[actor]" ) {
     REQUIRE(ecb == asio::error_code());
     REQUIRE(btb == 4);
 }
+
+TEST_CASE( "Actors on a pool", "[actor]" ) {
+    azmq::actor::pool pool(2);
+    REQUIRE(pool.size() == 2);
+
+    asio::io_service ios;
+    std::vector<azmq::socket> peers;
+    std::atomic<int> echoed{ 0 };
+    for (auto i = 0; i != 20; ++i) {
+        peers.emplace_back(azmq::actor::spawn_on(pool, ios, false, [&](azmq::socket & ss) {
+            ss.async_receive([&](asio::error_code const& ec, azmq::message & msg, size_t) {
+                if (ec)
+                    return;
+                ss.send(msg);
+                ++echoed;
+            });
+        }));
+    }
+
+    for (auto & p : peers) {
+        azmq::actor::is_alive alive;
+        p.get_option(alive);
+        REQUIRE(alive.value());
+        p.send(asio::buffer("ping"));
+    }
+    for (auto & p : peers) {
+        azmq::message msg;
+        p.receive(msg);
+        REQUIRE(msg.size() == 5);
+    }
+    REQUIRE(echoed == 20);
+
+    // an actor which throws is stopped and reports the error
+    auto thrower = azmq::actor::spawn_on(pool, [](azmq::socket &) {
+        throw std::runtime_error("oops");
+    });
+    azmq::actor::is_alive alive;
+    do {
+        std::this_thread::yield();
+        thrower.get_option(alive);
+    } while (alive.value());
+    azmq::actor::last_error last_error;
+    thrower.get_option(last_error);
+    REQUIRE(last_error.value());
+
+    // as is one whose completion handler throws, the pool's threads carry on
+    auto handler_thrower = azmq::actor::spawn_on(pool, [](azmq::socket & ss) {
+        ss.async_receive([](asio::error_code const& ec, azmq::message &, size_t) {
+            if (!ec)
+                throw std::runtime_error("oops");
+        });
+    });
+    handler_thrower.send(asio::buffer("ping"));
+    do {
+        std::this_thread::yield();
+        handler_thrower.get_option(alive);
+    } while (alive.value());
+    azmq::actor::last_error handler_error;
+    handler_thrower.get_option(handler_error);
+    REQUIRE(handler_error.value());
+    REQUIRE_FALSE(pool.last_error());
+
+    // joining cancels outstanding receives
+    peers.clear();
+}
+
+TEST_CASE( "Actors spawned from a pool's reserved pipes", "[actor]" ) {
+    azmq::actor::pool pool(1);
+    pool.reserve(4);
+
+    // more actors than the reserve, some get freshly created pipes
+    std::vector<azmq::socket> peers;
+    for (auto i = 0; i != 10; ++i) {
+        peers.emplace_back(azmq::actor::spawn_on(pool, [](azmq::socket & ss) {
+            ss.async_receive([&ss](asio::error_code const& ec, azmq::message & msg, size_t) {
+                if (!ec)
+                    ss.send(msg);
+            });
+        }));
+    }
+
+    for (auto & p : peers)
+        p.send(asio::buffer("ping"));
+    for (auto & p : peers) {
+        azmq::message msg;
+        p.receive(msg);
+        REQUIRE(msg.string() == std::string("ping", 5));
+    }
+    peers.clear();
+}
@@ -0,0 +1,99 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#ifndef AZMQ_TEST_DEFERRED_TOKEN_HPP_
+#define AZMQ_TEST_DEFERRED_TOKEN_HPP_
+
+#include <asio/async_result.hpp>
+
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// A completion token which, like asio::deferred, does not start the
+// operation. The initiating function returns a deferred operation holding
+// copies of the initiation and its arguments, which starts when it is called
+// with a completion handler, typically long after the initiating function's
+// arguments have gone.
+namespace test {
+    struct deferred_t { };
+    constexpr deferred_t deferred{ };
+
+    template<typename Signature>
+    class deferred_op;
+
+    template<typename... Results>
+    class deferred_op<void(Results...)> {
+    public:
+        using handler_type = std::function<void(Results...)>;
+
+        explicit deferred_op(std::function<void(handler_type)> launch)
+            : launch_(std::move(launch))
+        { }
+
+        void operator()(handler_type handler) {
+            auto launch = std::move(launch_);
+            launch(std::move(handler));
+        }
+
+    private:
+        std::function<void(handler_type)> launch_;
+    };
+
+namespace detail {
+    template<size_t... I>
+    struct indices { };
+
+    template<size_t N, size_t... I>
+    struct make_indices : make_indices<N - 1, N - 1, I...> { };
+
+    template<size_t... I>
+    struct make_indices<0, I...> { using type = indices<I...>; };
+
+    // the initiation with decay copies of its arguments, rvalues are moved
+    // in as asio::deferred does
+    template<typename Initiation, typename... Args>
+    struct launcher {
+        Initiation init;
+        std::tuple<Args...> args;
+
+        template<typename Handler>
+        void operator()(Handler && handler) {
+            launch(std::forward<Handler>(handler), typename make_indices<sizeof...(Args)>::type());
+        }
+
+        template<typename Handler, size_t... I>
+        void launch(Handler && handler, indices<I...>) {
+            init(std::forward<Handler>(handler), std::move(std::get<I>(args))...);
+        }
+    };
+} // namespace detail
+} // namespace test
+
+namespace asio {
+    template<typename... Results>
+    class async_result<test::deferred_t, void(Results...)> {
+    public:
+        using return_type = test::deferred_op<void(Results...)>;
+
+        template<typename Initiation, typename... Args>
+        static return_type initiate(Initiation && initiation, test::deferred_t, Args&&... args) {
+            using launcher_type = test::detail::launcher<typename std::decay<Initiation>::type,
+                                                         typename std::decay<Args>::type...>;
+            auto l = std::make_shared<launcher_type>(launcher_type{
+                        std::forward<Initiation>(initiation),
+                        std::tuple<typename std::decay<Args>::type...>(std::forward<Args>(args)...) });
+            return return_type([l](typename return_type::handler_type handler) {
+                (*l)(std::move(handler));
+            });
+        }
+    };
+} // namespace asio
+#endif // AZMQ_TEST_DEFERRED_TOKEN_HPP_
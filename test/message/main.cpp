@@ -7,6 +7,8 @@
     file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 */
 #include <azmq/message.hpp>
+#include <azmq/message_pool.hpp>
+#include <azmq/shared_message.hpp>
 
 #include <asio/buffer.hpp>
 
@@ -14,6 +16,8 @@
 #include <algorithm>
 #include <array>
 #include <iterator>
+#include <memory>
+#include <thread>
 
 #define CATCH_CONFIG_MAIN
 #include "../catch.hpp"
@@ -231,3 +235,181 @@ TEST_CASE( "message_sequence", "[message]" ) {
         REQUIRE(azmq::message(buf) == *it++);
     }
 }
+
+TEST_CASE( "small_message_vector", "[message]" ) {
+    std::array<asio::const_buffer, 3> bufs {{
+        asio::buffer("id"),
+        asio::buffer(""),
+        asio::buffer("body")
+    }};
+
+    auto res = azmq::to_message_vector<azmq::small_message_vector>(bufs);
+    REQUIRE(res.size() == 3);
+    REQUIRE(res.is_inline());
+    REQUIRE(res[2].string() == std::string("body", 5));
+
+    res.push_back(asio::buffer("four"));
+    REQUIRE(res.is_inline());
+
+    // the fifth part moves the parts to the heap
+    res.emplace_back(std::string(100, 'x'));
+    REQUIRE(!res.is_inline());
+    REQUIRE(res.size() == 5);
+    REQUIRE(res[0].string() == std::string("id", 3));
+    REQUIRE(res.back().size() == 100);
+
+    auto moved = std::move(res);
+    REQUIRE(res.empty());
+    REQUIRE(moved.size() == 5);
+
+    azmq::small_message_vector small{ azmq::message("a"), azmq::message("b") };
+    auto moved_small = std::move(small);
+    REQUIRE(moved_small.is_inline());
+    REQUIRE(moved_small[1].string() == "b");
+
+    auto copy = moved_small;
+    REQUIRE(copy.size() == 2);
+    REQUIRE(copy[0] == moved_small[0]);
+
+    copy.clear();
+    REQUIRE(copy.empty());
+
+    // growing with a copy of one of the vector's own elements, from inline
+    // storage and from the heap
+    azmq::small_message_vector self{ azmq::message("a"), azmq::message("b"),
+                                     azmq::message("c"), azmq::message("d") };
+    self.emplace_back(self[0]);
+    REQUIRE(!self.is_inline());
+    REQUIRE(self.back().string() == "a");
+    while (self.size() != self.capacity())
+        self.push_back(self[1]);
+    self.push_back(self[3]);
+    REQUIRE(self.size() == 9);
+    REQUIRE(self.back().string() == "d");
+    REQUIRE(self[7].string() == "b");
+}
+
+TEST_CASE( "message_pool", "[message]" ) {
+    azmq::message_pool pool;
+
+    // inline and oversized payloads bypass the pool
+    REQUIRE(pool.get(8).size() == 8);
+    REQUIRE(pool.get(azmq::message_pool::max_size() + 1).size() == azmq::message_pool::max_size() + 1);
+
+    std::string s(200, 'x');
+    auto m = pool.get(asio::buffer(s));
+    REQUIRE(m.size() == 200);
+    REQUIRE(m.string() == s);
+
+    // a released block is handed out again
+    auto p = m.data();
+    m = azmq::message();
+    auto mm = pool.get(150);
+    REQUIRE(mm.size() == 150);
+    REQUIRE(mm.data() == p);
+
+    // copies share the block, it returns to the pool with the last one
+    azmq::message copy(mm);
+    REQUIRE(copy.data() == p);
+    mm = azmq::message();
+    REQUIRE(pool.get(150).data() != p);
+    copy = azmq::message();
+    REQUIRE(pool.get(150).data() == p);
+}
+
+TEST_CASE( "message_pool_thread_caches", "[message]" ) {
+    azmq::message_pool a;
+    azmq::message_pool b;
+
+    // alternating between pools keeps each pool's cached blocks, so another
+    // thread does not get a's released block from the central free list
+    auto m = a.get(150);
+    auto p = m.data();
+    m = azmq::message();
+    REQUIRE(b.get(150).size() == 150);
+    void const* q = nullptr;
+    std::thread([&] { q = a.get(150).data(); }).join();
+    REQUIRE(q != p);
+    REQUIRE(a.get(150).data() == p);
+
+    // a thread which only releases blocks returns them to the central free
+    // list rather than caching them
+    m = a.get(150);
+    p = m.data();
+    std::thread([&] {
+        m = azmq::message();
+        std::thread([&] { q = a.get(150).data(); }).join();
+    }).join();
+    REQUIRE(q == p);
+
+    // a block released by a thread_local destroyed after the thread's cache
+    // goes straight back to the pool
+    std::thread([&] {
+        static thread_local azmq::message held;
+        held = a.get(150);
+    }).join();
+    REQUIRE(a.get(150).size() == 150);
+}
+
+TEST_CASE( "message_pool_outlives_pool", "[message]" ) {
+    azmq::message m;
+    {
+        azmq::message_pool pool;
+        m = pool.get(azmq::message(std::string(1000, 'y')).cbuffer());
+    }
+    REQUIRE(m.string() == std::string(1000, 'y'));
+}
+
+TEST_CASE( "shared_message", "[message]" ) {
+    std::string s(100, 'z');
+    azmq::shared_message sm(s);
+    REQUIRE(sm.size() == 100);
+    REQUIRE(sm.string() == s);
+
+    // copies and shares refer to the same payload
+    auto copy = sm;
+    REQUIRE(copy.data() == sm.data());
+    auto m = sm.share();
+    REQUIRE(m.data() == sm.data());
+
+    // clone is private and writable
+    auto c = sm.clone();
+    REQUIRE(c.data() != sm.data());
+    asio::buffer_copy(c.buffer(), asio::buffer("a", 1));
+    REQUIRE(sm.string() == s);
+    REQUIRE(c.string() != s);
+
+    // zero copy from caller owned storage, released with the last reference
+    auto owner = std::make_shared<std::string>(64, 'q');
+    std::weak_ptr<std::string> watch = owner;
+    {
+        azmq::shared_message zc(std::move(owner), asio::buffer(*watch.lock()));
+        auto m2 = zc.share();
+        REQUIRE(m2.data() == watch.lock()->data());
+        REQUIRE(!watch.expired());
+    }
+    REQUIRE(watch.expired());
+}
+
+TEST_CASE( "message_buffer_copy_on_write", "[message]" ) {
+    // exclusively owned payloads are written in place
+    azmq::message m(std::string(100, 'a'));
+    auto p = m.data();
+    REQUIRE(asio::buffer_cast<void*>(m.buffer()) == p);
+
+    // a copy shares the payload, writing through either one copies first
+    azmq::message copy(m);
+    REQUIRE(copy.data() == p);
+    auto b = copy.buffer();
+    REQUIRE(asio::buffer_cast<void*>(b) != p);
+    REQUIRE(asio::buffer_cast<void*>(copy.buffer()) == asio::buffer_cast<void*>(b));
+    asio::buffer_copy(b, asio::buffer("b", 1));
+    REQUIRE(m.string() == std::string(100, 'a'));
+
+    // constant payloads are never written
+    std::string s(100, 'c');
+    azmq::message c(azmq::nocopy, asio::buffer(s));
+    asio::buffer_copy(c.buffer(), asio::buffer("d", 1));
+    REQUIRE(s == std::string(100, 'c'));
+    REQUIRE(c.string()[0] == 'd');
+}
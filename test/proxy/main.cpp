@@ -0,0 +1,273 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+#include <azmq/proxy.hpp>
+
+#include <asio/io_service.hpp>
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#define CATCH_CONFIG_MAIN
+#include "../catch.hpp"
+
+namespace {
+    // run the io_service until pred holds, or give up after about a second
+    template<typename Pred>
+    bool run_until(asio::io_service & ios, Pred pred) {
+        for (auto i = 0; i != 1000 && !pred(); ++i) {
+            ios.poll();
+            ios.reset();
+            if (!pred())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return pred();
+    }
+}
+
+TEST_CASE( "Proxy forwards multipart messages both ways", "[proxy]" ) {
+    asio::io_service ios;
+
+    azmq::router_socket frontend(ios);
+    frontend.bind("inproc://proxy-frontend");
+    azmq::dealer_socket backend(ios);
+    backend.bind("inproc://proxy-backend");
+
+    azmq::dealer_socket client(ios);
+    client.connect("inproc://proxy-frontend");
+    azmq::router_socket server(ios);
+    server.connect("inproc://proxy-backend");
+
+    azmq::proxy p(std::move(frontend), std::move(backend));
+
+    client.send(azmq::message("hello"), ZMQ_SNDMORE);
+    client.send(azmq::message("world"));
+
+    // the server sees the client's identity, then the client's parts
+    azmq::message_vector req;
+    REQUIRE(run_until(ios, [&] {
+        asio::error_code ec;
+        if (req.empty())
+            server.receive_more(req, ZMQ_DONTWAIT, ec);
+        return !req.empty();
+    }));
+    REQUIRE(req.size() == 4);
+    REQUIRE(req[2].string() == "hello");
+    REQUIRE(req[3].string() == "world");
+    REQUIRE_FALSE(req[3].more());
+
+    // and the reply finds its way back through the frontend router
+    req[3] = azmq::message("reply");
+    server.send(req);
+
+    azmq::message_vector rep;
+    REQUIRE(run_until(ios, [&] {
+        asio::error_code ec;
+        if (rep.empty())
+            client.receive_more(rep, ZMQ_DONTWAIT, ec);
+        return !rep.empty();
+    }));
+    REQUIRE(rep.size() == 2);
+    REQUIRE(rep[0].string() == "hello");
+    REQUIRE(rep[1].string() == "reply");
+
+    REQUIRE(p.frontend_to_backend().messages == 1);
+    REQUIRE(p.frontend_to_backend().bytes == req[0].size() + 10);
+    REQUIRE(p.backend_to_frontend().messages == 1);
+    REQUIRE(p.backend_to_frontend().bytes == req[0].size() + 10);
+}
+
+TEST_CASE( "Proxy sends a copy of every part to capture", "[proxy]" ) {
+    asio::io_service ios;
+
+    azmq::pull_socket frontend(ios);
+    frontend.bind("inproc://proxy-capture-frontend");
+    azmq::push_socket backend(ios);
+    backend.bind("inproc://proxy-capture-backend");
+    azmq::pair_socket capture(ios);
+    capture.bind("inproc://proxy-capture");
+
+    azmq::push_socket client(ios);
+    client.connect("inproc://proxy-capture-frontend");
+    azmq::pull_socket server(ios);
+    server.connect("inproc://proxy-capture-backend");
+    azmq::pair_socket listener(ios);
+    listener.connect("inproc://proxy-capture");
+
+    azmq::proxy p(std::move(frontend), std::move(backend), std::move(capture));
+
+    for (auto i = 0; i != 10; ++i) {
+        client.send(azmq::message("part"), ZMQ_SNDMORE);
+        client.send(azmq::message(std::to_string(i)));
+    }
+
+    size_t received = 0;
+    size_t captured = 0;
+    REQUIRE(run_until(ios, [&] {
+        asio::error_code ec;
+        azmq::message_vector vec;
+        while (received != 10 && server.receive_more(vec, ZMQ_DONTWAIT, ec)) {
+            if (vec.size() == 2 && vec[1].string() == std::to_string(received))
+                ++received;
+            vec.clear();
+        }
+        while (captured != 10 && listener.receive_more(vec, ZMQ_DONTWAIT, ec)) {
+            if (vec.size() == 2 && vec[1].string() == std::to_string(captured))
+                ++captured;
+            vec.clear();
+        }
+        return received == 10 && captured == 10;
+    }));
+    REQUIRE(p.frontend_to_backend().messages == 10);
+    REQUIRE(p.backend_to_frontend().messages == 0);
+}
+
+TEST_CASE( "Proxy pause, resume and terminate", "[proxy]" ) {
+    asio::io_service ios;
+
+    azmq::pull_socket frontend(ios);
+    frontend.bind("inproc://proxy-control-frontend");
+    azmq::push_socket backend(ios);
+    backend.bind("inproc://proxy-control-backend");
+
+    azmq::push_socket client(ios);
+    client.connect("inproc://proxy-control-frontend");
+    azmq::pull_socket server(ios);
+    server.connect("inproc://proxy-control-backend");
+
+    azmq::proxy p(std::move(frontend), std::move(backend), 1);
+
+    auto drain = [&](size_t n) {
+        size_t got = 0;
+        run_until(ios, [&] {
+            asio::error_code ec;
+            azmq::message msg;
+            while (server.receive(msg, ZMQ_DONTWAIT, ec))
+                ++got;
+            return got >= n;
+        });
+        return got;
+    };
+
+    client.send(azmq::message("a"));
+    REQUIRE(drain(1) == 1);
+
+    p.pause();
+    REQUIRE(p.is_paused());
+    // a receive was already outstanding, at most its message gets through
+    client.send(azmq::message("b"));
+    client.send(azmq::message("c"));
+    client.send(azmq::message("d"));
+    auto got = drain(3);
+    REQUIRE(got <= 1);
+
+    p.resume();
+    REQUIRE_FALSE(p.is_paused());
+    got += drain(3 - got);
+    REQUIRE(got == 3);
+    REQUIRE(p.frontend_to_backend().messages == 4);
+
+    p.terminate();
+    REQUIRE(p.is_terminated());
+    REQUIRE_FALSE(p.last_error());
+    client.send(azmq::message("e"));
+    REQUIRE(drain(1) == 0);
+    REQUIRE(p.frontend_to_backend().messages == 4);
+}
+
+TEST_CASE( "Proxy stops receiving while the output is at its high water mark", "[proxy]" ) {
+    asio::io_service ios;
+
+    azmq::pull_socket frontend(ios);
+    frontend.set_option(azmq::socket::rcv_hwm(1));
+    frontend.bind("inproc://proxy-hwm-frontend");
+    azmq::push_socket backend(ios);
+    backend.set_option(azmq::socket::snd_hwm(1));
+    backend.bind("inproc://proxy-hwm-backend");
+
+    azmq::push_socket client(ios);
+    client.set_option(azmq::socket::snd_hwm(1));
+    client.connect("inproc://proxy-hwm-frontend");
+    azmq::pull_socket server(ios);
+    server.set_option(azmq::socket::rcv_hwm(1));
+    server.connect("inproc://proxy-hwm-backend");
+
+    azmq::proxy p(std::move(frontend), std::move(backend), 4);
+
+    // nobody reads from server, so the proxy can only take in what the
+    // backend pipe has room for and client is left blocked at its own hwm
+    size_t sent = 0;
+    run_until(ios, [&] {
+        asio::error_code ec;
+        while (sent != 100 && client.send(azmq::message("x"), ZMQ_DONTWAIT, ec))
+            ++sent;
+        return sent == 100;
+    });
+    REQUIRE(sent < 100);
+    auto forwarded = p.frontend_to_backend().messages;
+    REQUIRE(forwarded < sent);
+
+    // once server reads, everything still arrives, in order and just once
+    size_t received = 0;
+    REQUIRE(run_until(ios, [&] {
+        asio::error_code ec;
+        azmq::message msg;
+        while (server.receive(msg, ZMQ_DONTWAIT, ec))
+            ++received;
+        while (sent != 100 && client.send(azmq::message("x"), ZMQ_DONTWAIT, ec))
+            ++sent;
+        return received == 100;
+    }));
+    REQUIRE(p.frontend_to_backend().messages == 100);
+}
+
+TEST_CASE( "Proxy move assignment terminates the replaced proxy", "[proxy]" ) {
+    asio::io_service ios;
+
+    azmq::pull_socket frontend(ios);
+    frontend.bind("inproc://proxy-assign-frontend");
+    azmq::push_socket backend(ios);
+    backend.bind("inproc://proxy-assign-backend");
+    azmq::pull_socket other_frontend(ios);
+    other_frontend.bind("inproc://proxy-assign-other-frontend");
+    azmq::push_socket other_backend(ios);
+    other_backend.bind("inproc://proxy-assign-other-backend");
+
+    azmq::push_socket client(ios);
+    client.connect("inproc://proxy-assign-frontend");
+    azmq::pull_socket server(ios);
+    server.connect("inproc://proxy-assign-backend");
+    azmq::push_socket other_client(ios);
+    other_client.connect("inproc://proxy-assign-other-frontend");
+    azmq::pull_socket other_server(ios);
+    other_server.connect("inproc://proxy-assign-other-backend");
+
+    auto drain = [&](azmq::socket & s, size_t n) {
+        size_t got = 0;
+        run_until(ios, [&] {
+            asio::error_code ec;
+            azmq::message msg;
+            while (s.receive(msg, ZMQ_DONTWAIT, ec))
+                ++got;
+            return got >= n;
+        });
+        return got;
+    };
+
+    azmq::proxy p(std::move(frontend), std::move(backend));
+    p = azmq::proxy(std::move(other_frontend), std::move(other_backend));
+
+    client.send(azmq::message("a"));
+    REQUIRE(drain(server, 1) == 0);
+
+    other_client.send(azmq::message("b"));
+    REQUIRE(drain(other_server, 1) == 1);
+    REQUIRE(p.frontend_to_backend().messages == 1);
+}
@@ -9,9 +9,13 @@
 #include <azmq/signal.hpp>
 
 #include <asio/io_service.hpp>
+#include <asio/version.hpp>
 
 #define CATCH_CONFIG_MAIN
 #include "../catch.hpp"
+#if ASIO_VERSION >= 101400
+#include "../deferred_token.hpp"
+#endif
 
 TEST_CASE( "Send/Receive a signal", "[signal]" ) {
     asio::io_service ios;
@@ -24,3 +28,80 @@ TEST_CASE( "Send/Receive a signal", "[signal]" ) {
     azmq::signal::send(sb, 123);
     REQUIRE( azmq::signal::wait(sc) == 123);
 }
+
+TEST_CASE( "Messages ahead of a signal are kept", "[signal]" ) {
+    asio::io_service ios;
+    azmq::pair_socket sb(ios);
+    azmq::pair_socket sc(ios);
+
+    sb.bind("inproc://test-pending");
+    sc.connect("inproc://test-pending");
+
+    // an 8 byte part of a multipart message is not a signal
+    uint64_t v = 0x77664433221100u + 7;
+    sb.send(azmq::message("hello"));
+    sb.send(azmq::message("part"), ZMQ_SNDMORE);
+    sb.send(asio::buffer(&v, sizeof(v)));
+    azmq::signal::send(sb, 42);
+
+    azmq::message_vector pending;
+    REQUIRE(azmq::signal::wait(sc, &pending) == 42);
+    REQUIRE(pending.size() == 3);
+    REQUIRE(pending[0].string() == "hello");
+    REQUIRE(pending[1].string() == "part");
+    REQUIRE(pending[1].more());
+    REQUIRE(pending[2].size() == sizeof(v));
+}
+
+TEST_CASE( "Async send/wait a signal", "[signal]" ) {
+    asio::io_service ios;
+    azmq::pair_socket sb(ios);
+    azmq::pair_socket sc(ios);
+
+    sb.bind("inproc://test-async");
+    sc.connect("inproc://test-async");
+
+    azmq::message_vector pending;
+    asio::error_code wait_ec;
+    int status = -1;
+    azmq::signal::async_wait(sc, &pending, [&](asio::error_code const& ec, uint8_t s) {
+        wait_ec = ec;
+        status = s;
+    });
+
+    size_t sent = 0;
+    sb.async_send(azmq::message("first"), [](asio::error_code const&, size_t) { });
+    azmq::signal::async_send(sb, 9, [&](asio::error_code const& ec, size_t bytes_transferred) {
+        REQUIRE(!ec);
+        sent = bytes_transferred;
+    });
+    ios.run();
+
+    REQUIRE(sent == 8);
+    REQUIRE(!wait_ec);
+    REQUIRE(status == 9);
+    REQUIRE(pending.size() == 1);
+    REQUIRE(pending[0].string() == "first");
+}
+
+#if ASIO_VERSION >= 101400
+TEST_CASE( "Deferred send of a signal", "[signal]" ) {
+    asio::io_service ios;
+    azmq::pair_socket sb(ios);
+    azmq::pair_socket sc(ios);
+
+    sb.bind("inproc://test-deferred");
+    sc.connect("inproc://test-deferred");
+
+    // the encoded signal is gone by the time the send starts
+    auto send = azmq::signal::async_send(sb, 42, test::deferred);
+    size_t sent = 0;
+    send([&](asio::error_code const& ec, size_t bytes_transferred) {
+        if (!ec) sent = bytes_transferred;
+    });
+    ios.run();
+
+    REQUIRE(sent == 8);
+    REQUIRE(azmq::signal::wait(sc) == 42);
+}
+#endif
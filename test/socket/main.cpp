@@ -10,6 +10,11 @@
 #include <azmq/util/scope_guard.hpp>
 
 #include <asio/buffer.hpp>
+#include <asio/use_future.hpp>
+#include <asio/version.hpp>
+#if ASIO_VERSION >= 101100
+#include <asio/bind_executor.hpp>
+#endif
 
 #include <array>
 #include <thread>
@@ -19,9 +24,18 @@
 #include <cstdint>
 #include <memory>
 #include <chrono>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <unordered_map>
+#include <cstdlib>
+#include <new>
 
 #define CATCH_CONFIG_MAIN
 #include "../catch.hpp"
+#if ASIO_VERSION >= 101400
+#include "../deferred_token.hpp"
+#endif
 
 std::array<asio::const_buffer, 2> snd_bufs = {{
     asio::buffer("A"),
@@ -32,6 +46,19 @@ std::string subj(const char* name) {
     return std::string("inproc://") + name;
 }
 
+std::atomic<size_t> allocations{ 0 };
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (auto p = std::malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
 TEST_CASE( "Set/Get options", "[socket]" ) {
     asio::io_service ios;
 
@@ -51,6 +78,63 @@ TEST_CASE( "Set/Get options", "[socket]" ) {
     azmq::socket::allow_speculative out_speculative;
     s.get_option(out_speculative);
     REQUIRE(in_speculative.value() == out_speculative.value());
+
+    azmq::socket::sticky_registration in_sticky(100);
+    s.set_option(in_sticky);
+
+    azmq::socket::sticky_registration out_sticky;
+    s.get_option(out_sticky);
+    REQUIRE(in_sticky.value() == out_sticky.value());
+}
+
+namespace {
+    // handles one user defined option, reports not_supported for the rest
+    struct value_ext {
+        using value = azmq::opt::integer<+azmq::opt::limits::user_socket_min>;
+
+        std::shared_ptr<int> value_;
+
+        void on_install(asio::io_service &, void *) { }
+        void on_remove() { }
+
+        template<typename Option>
+        asio::error_code set_option(Option const& opt, asio::error_code & ec) {
+            if (opt.name() != value::static_name::value)
+                return ec = make_error_code(std::errc::not_supported);
+            *value_ = *static_cast<int const*>(opt.data());
+            return ec;
+        }
+
+        template<typename Option>
+        asio::error_code get_option(Option & opt, asio::error_code & ec) {
+            if (opt.name() != value::static_name::value)
+                return ec = make_error_code(std::errc::not_supported);
+            *static_cast<int*>(opt.data()) = *value_;
+            return ec;
+        }
+    };
+} // namespace
+
+TEST_CASE( "Set/Get options through an extension", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket s(ios, ZMQ_ROUTER);
+    auto value = std::make_shared<int>(0);
+    REQUIRE(azmq::detail::associate_ext(s, value_ext{ value }));
+
+    // an option the extension handles is not passed on to the socket
+    s.set_option(value_ext::value(42));
+    REQUIRE(*value == 42);
+    value_ext::value out_value;
+    s.get_option(out_value);
+    REQUIRE(out_value.value() == 42);
+
+    // one it reports not_supported for is
+    azmq::socket::rcv_hwm in_hwm(42);
+    s.set_option(in_hwm);
+    azmq::socket::rcv_hwm out_hwm;
+    s.get_option(out_hwm);
+    REQUIRE(in_hwm.value() == out_hwm.value());
 }
 
 TEST_CASE( "Send/Receive single buffer", "[socket]") {
@@ -74,6 +158,42 @@ TEST_CASE( "Send/Receive single buffer", "[socket]") {
     REQUIRE(std::memcmp(msg, buf.data(), 5) == 0);
 }
 
+TEST_CASE( "Single buffer receive reports more parts only when asked", "[socket]") {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    sc.send(asio::buffer("A"), ZMQ_SNDMORE);
+    sc.send(asio::buffer("B"), ZMQ_SNDMORE);
+    sc.send(asio::buffer("C"), ZMQ_SNDMORE);
+    sc.send(asio::buffer("D"));
+
+    std::array<char, 2> buf;
+    asio::error_code ec;
+    REQUIRE(sb.receive(asio::buffer(buf), 0, ec) == 2);
+    REQUIRE(!ec);
+    REQUIRE(sb.receive(asio::buffer(buf), ZMQ_RCVMORE, ec) == 2);
+    REQUIRE(ec == std::errc::no_buffer_space);
+
+    azmq::socket::more_result_type res;
+    sb.async_receive_more(asio::buffer(buf), [&](asio::error_code const& e, azmq::socket::more_result_type r) {
+        REQUIRE(e == std::errc::no_buffer_space);
+        res = r;
+    });
+    ios.run();
+    REQUIRE(res.first == 2);
+    REQUIRE(res.second);
+    REQUIRE(buf[0] == 'C');
+
+    REQUIRE(sb.receive(asio::buffer(buf), ZMQ_RCVMORE, ec) == 2);
+    REQUIRE(!ec);
+    REQUIRE(buf[0] == 'D');
+}
+
 TEST_CASE( "Send/Receive synchronous", "[socket]" ) {
     asio::io_service ios;
 
@@ -564,3 +684,1136 @@ TEST_CASE( "Loopback", "[socket]" ) {
     REQUIRE(s.ec == asio::error_code());
     REQUIRE(s.ct == ct);
 }
+
+TEST_CASE( "Async receive does not allocate in steady state", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    size_t ct = 1000;
+    for (auto i = 0u; i < ct; ++i)
+        sc.send(asio::buffer(&i, sizeof(i)));
+
+    asio::io_service::work w(ios);
+    size_t received = 0;
+    auto receive = [&] {
+        sb.async_receive([&](asio::error_code const& ec, azmq::message &, size_t) {
+            if (!ec)
+                ++received;
+        });
+        ios.run_one();
+    };
+
+    // first pass primes the operation storage cache
+    receive();
+
+    auto before = allocations.load();
+    for (auto i = 1u; i < ct; ++i)
+        receive();
+    auto after = allocations.load();
+
+    REQUIRE(received == ct);
+    REQUIRE(after == before);
+}
+
+struct counted_handler {
+    size_t & allocs_;
+    size_t & deallocs_;
+    asio::error_code & ec_;
+
+    void operator()(asio::error_code const& ec, size_t) { ec_ = ec; }
+
+    friend void* asio_handler_allocate(size_t size, counted_handler* h) {
+        ++h->allocs_;
+        return ::operator new(size);
+    }
+
+    friend void asio_handler_deallocate(void* p, size_t, counted_handler* h) {
+        ++h->deallocs_;
+        ::operator delete(p);
+    }
+};
+
+TEST_CASE( "Async operations honour handler allocation hooks", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    size_t allocs = 0;
+    size_t deallocs = 0;
+    asio::error_code ecc;
+    asio::error_code ecb;
+
+    std::array<char, 2> buf;
+    sb.async_receive(asio::buffer(buf), counted_handler{ allocs, deallocs, ecb });
+    sc.async_send(asio::buffer("A"), counted_handler{ allocs, deallocs, ecc });
+
+    ios.run();
+
+    REQUIRE(ecc == asio::error_code());
+    REQUIRE(ecb == asio::error_code());
+    REQUIRE(allocs == 2);
+    REQUIRE(deallocs == 2);
+}
+
+TEST_CASE( "Async receive batch", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PULL);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PUSH);
+    sc.connect(subj(__func__));
+
+    for (auto i = 0u; i < 10; ++i)
+        sc.send(asio::buffer(&i, sizeof(i)));
+
+    azmq::message_vector vec;
+    std::vector<size_t> batches;
+    asio::error_code ecb;
+    size_t btb = 0;
+    std::function<void()> receive = [&] {
+        vec.clear();
+        sb.async_receive_batch(vec, 4, [&](asio::error_code const& ec, size_t bytes_transferred) {
+            ecb = ec;
+            if (ec)
+                return;
+            btb += bytes_transferred;
+            batches.push_back(vec.size());
+            if (vec.back().buffer_cast<unsigned>() != 9)
+                receive();
+        });
+    };
+    receive();
+    ios.run();
+
+    REQUIRE(ecb == asio::error_code());
+    REQUIRE(btb == 10 * sizeof(unsigned));
+    REQUIRE(batches.size() == 3);
+    CHECK(batches[0] == 4);
+    CHECK(batches[1] == 4);
+    CHECK(batches[2] == 2);
+}
+
+TEST_CASE( "Async receive batch of multipart messages", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PULL);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PUSH);
+    sc.connect(subj(__func__));
+
+    for (auto i = 0u; i < 3; ++i)
+        sc.send(snd_bufs);
+
+    azmq::message_vector vec;
+    asio::error_code ecb;
+    size_t btb = 0;
+    sb.async_receive_batch(vec, 2, [&](asio::error_code const& ec, size_t bytes_transferred) {
+        ecb = ec;
+        btb = bytes_transferred;
+    });
+    ios.run();
+
+    REQUIRE(ecb == asio::error_code());
+    REQUIRE(btb == 8);
+    REQUIRE(vec.size() == 4);
+    CHECK(vec[0].more());
+    CHECK(!vec[1].more());
+    CHECK(vec[2].more());
+    CHECK(!vec[3].more());
+}
+
+TEST_CASE( "Async receive batch with an lvalue handler or a completion token", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PULL);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PUSH);
+    sc.connect(subj(__func__));
+
+    azmq::message_vector vec;
+    size_t btb = 0;
+    {
+        // the operation holds a copy of the handler, not a reference to it
+        auto handler = [&btb](asio::error_code const& ec, size_t bytes_transferred) {
+            if (!ec) btb = bytes_transferred;
+        };
+        sb.async_receive_batch(vec, 4, handler);
+    }
+    sc.send(asio::buffer("A"));
+    sc.send(asio::buffer("B"));
+    ios.run();
+    REQUIRE(btb == 4);
+
+    azmq::message_vector more;
+    auto received = sb.async_receive_batch(more, 4, asio::use_future);
+    sc.send(asio::buffer("CC"));
+    ios.reset();
+    ios.run();
+    REQUIRE(received.get() == 3);
+    REQUIRE(more.size() == 1);
+}
+
+TEST_CASE( "Async receive multipart", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::router_socket sb(ios);
+    sb.bind(subj(__func__));
+
+    azmq::dealer_socket sc(ios);
+    sc.connect(subj(__func__));
+
+    // initiated before anything has arrived
+    azmq::message_vector vec;
+    asio::error_code ecb;
+    size_t btb = 0;
+    size_t calls = 0;
+    sb.async_receive_multipart(vec, [&](asio::error_code const& ec, size_t bytes_transferred) {
+        ecb = ec;
+        btb = bytes_transferred;
+        ++calls;
+    });
+    ios.poll();
+    REQUIRE(calls == 0);
+
+    sc.send(snd_bufs);
+    sc.send(snd_bufs);
+    ios.run();
+
+    REQUIRE(ecb == asio::error_code());
+    REQUIRE(calls == 1);
+    // identity, then the two parts sent, and nothing of the second message
+    REQUIRE(vec.size() == 3);
+    CHECK(vec[0].more());
+    CHECK(vec[1].more());
+    CHECK(!vec[2].more());
+    CHECK(btb == vec[0].size() + 4);
+    CHECK(vec[1].string() == std::string("A", 2));
+    CHECK(vec[2].string() == std::string("B", 2));
+
+    ios.reset();
+    azmq::message_vector vec2;
+    sb.async_receive_multipart(vec2, [&](asio::error_code const& ec, size_t) {
+        ecb = ec;
+        ++calls;
+    });
+    ios.run();
+    REQUIRE(ecb == asio::error_code());
+    REQUIRE(calls == 2);
+    REQUIRE(vec2.size() == 3);
+    CHECK(vec2[0] == vec[0]);
+}
+
+TEST_CASE( "Multipart send and receive with small_message_vector", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::router_socket sb(ios);
+    sb.bind(subj(__func__));
+
+    azmq::dealer_socket sc(ios);
+    sc.connect(subj(__func__));
+
+    // parts of a message container are sent without copying the payload
+    azmq::small_message_vector out{ azmq::message(""),
+                                    azmq::message(std::string(100, 'x')) };
+    sc.send(out);
+    REQUIRE(out.size() == 2);
+    REQUIRE(out[1].size() == 100);
+
+    azmq::small_message_vector in;
+    sb.receive_more(in, 0);
+    REQUIRE(in.size() == 3);
+    REQUIRE(in.is_inline());
+    CHECK(in[1].size() == 0);
+    CHECK(in[2] == out[1]);
+    // inproc hands over the very same payload
+    CHECK(in[2].data() == out[1].data());
+
+    // and back, the router's reply carries the identity it received
+    sb.send(in);
+    azmq::small_message_vector reply;
+    asio::error_code ec;
+    sc.async_receive_multipart(reply, [&](asio::error_code const& e, size_t) { ec = e; });
+    ios.run();
+    REQUIRE(ec == asio::error_code());
+    REQUIRE(reply.size() == 2);
+    CHECK(reply[1] == out[1]);
+}
+
+TEST_CASE( "Envelope and reply", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::router_socket sb(ios);
+    sb.bind(subj(__func__));
+
+    azmq::req_socket req(ios);
+    req.connect(subj(__func__));
+
+    azmq::dealer_socket dealer(ios);
+    dealer.set_option(azmq::socket::identity("dealer-1"));
+    dealer.connect(subj(__func__));
+
+    std::unordered_map<azmq::identity, int> requests;
+
+    // REQ sends a delimiter ahead of the body
+    req.send(asio::buffer("ping"));
+    azmq::small_message_vector parts;
+    sb.receive_more(parts, 0);
+    azmq::envelope env(std::move(parts));
+    REQUIRE(env.routing().size() == 1);
+    REQUIRE(env.has_delimiter());
+    REQUIRE(env.body().size() == 1);
+    REQUIRE(env.body()[0].string() == std::string("ping", 5));
+    ++requests[env.peer()];
+
+    sb.reply(env, asio::buffer("pong"));
+    azmq::message msg;
+    req.receive(msg);
+    REQUIRE(msg.string() == std::string("pong", 5));
+    REQUIRE(!msg.more());
+
+    // DEALER sends no delimiter, the reply has none either
+    std::array<asio::const_buffer, 2> request = {{ asio::buffer("a"), asio::buffer("b") }};
+    dealer.send(request);
+    azmq::message_vector vparts;
+    sb.receive_more(vparts, 0);
+    azmq::envelope denv(std::move(vparts));
+    REQUIRE(!denv.has_delimiter());
+    REQUIRE(denv.peer().string() == "dealer-1");
+    REQUIRE(denv.body().size() == 2);
+    ++requests[denv.peer()];
+    ++requests[azmq::identity(azmq::message("dealer-1"))];
+    REQUIRE(requests.size() == 2);
+    REQUIRE(requests[denv.peer()] == 2);
+    REQUIRE(denv.peer() != env.peer());
+
+    asio::error_code ec;
+    size_t bt = 0;
+    sb.async_reply(denv, denv.body(), [&](asio::error_code const& e, size_t bytes_transferred) {
+        ec = e;
+        bt = bytes_transferred;
+    });
+    ios.run();
+    REQUIRE(ec == asio::error_code());
+    REQUIRE(bt == 8 + 4);
+
+    azmq::small_message_vector echoed;
+    dealer.receive_more(echoed, 0);
+    REQUIRE(echoed.size() == 2);
+    CHECK(echoed[0].string() == std::string("a", 2));
+    CHECK(echoed[1].string() == std::string("b", 2));
+
+#if ASIO_VERSION >= 101400
+    // a deferred reply owns its parts, the envelope may be gone before it
+    // starts
+    std::unique_ptr<azmq::envelope> later(new azmq::envelope(denv.release()));
+    auto reply = sb.async_reply(*later, std::string("later"), test::deferred);
+    later.reset();
+    reply([&](asio::error_code const& e, size_t bytes_transferred) {
+        ec = e;
+        bt = bytes_transferred;
+    });
+    ios.reset();
+    ios.run();
+    REQUIRE(ec == asio::error_code());
+    REQUIRE(bt == 8 + 5);
+    echoed.clear();
+    dealer.receive_more(echoed, 0);
+    REQUIRE(echoed.size() == 1);
+    CHECK(echoed[0].string() == "later");
+#endif
+}
+
+TEST_CASE( "Reply with a string literal", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::router_socket sb(ios);
+    sb.bind(subj(__func__));
+
+    azmq::req_socket req(ios);
+    req.connect(subj(__func__));
+
+    // a literal is one part, without its terminating nul
+    req.send(asio::buffer("ping"));
+    azmq::small_message_vector parts;
+    sb.receive_more(parts, 0);
+    azmq::envelope env(std::move(parts));
+    sb.reply(env, "OK");
+    azmq::message msg;
+    req.receive(msg);
+    REQUIRE(msg.string() == "OK");
+
+    req.send(asio::buffer("ping"));
+    parts.clear();
+    sb.receive_more(parts, 0);
+    azmq::envelope again(std::move(parts));
+    asio::error_code ec;
+    sb.async_reply(again, "async", [&](asio::error_code const& e, size_t) { ec = e; });
+    ios.run();
+    REQUIRE(ec == asio::error_code());
+    req.receive(msg);
+    REQUIRE(msg.string() == "async");
+}
+
+TEST_CASE( "Async send of owned multipart messages", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PULL);
+    sb.set_option(azmq::socket::rcv_hwm(1));
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PUSH);
+    sc.set_option(azmq::socket::snd_hwm(1));
+    sc.connect(subj(__func__));
+
+    // more messages than the pipe holds, so the socket pushes back while
+    // the sends are queued
+    const size_t ct = 20;
+    const size_t parts = 3;
+    static std::array<std::array<char, 100>, ct * parts> payloads;
+    std::atomic<size_t> released{ 0 };
+    size_t sent = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i != ct; ++i) {
+        azmq::message_vector msgs;
+        for (size_t j = 0; j != parts; ++j) {
+            auto & p = payloads[i * parts + j];
+            p.fill(static_cast<char>(i));
+            msgs.emplace_back(azmq::nocopy, asio::buffer(p), [&](void*) { ++released; });
+        }
+        sc.async_send(std::move(msgs), [&](asio::error_code const& ec, size_t bytes_transferred) {
+            REQUIRE(ec == asio::error_code());
+            bytes += bytes_transferred;
+            ++sent;
+        });
+    }
+
+    size_t received_ok = 0;
+    std::thread t([&] {
+        for (size_t i = 0; i != ct; ++i) {
+            azmq::small_message_vector in;
+            sb.receive_more(in, 0);
+            if (in.size() != parts)
+                continue;
+            auto ok = true;
+            for (size_t j = 0; j != parts; ++j) {
+                // the very frames that were built, in order
+                ok = ok && in[j].data() == payloads[i * parts + j].data()
+                        && in[j].more() == (j + 1 != parts);
+            }
+            received_ok += ok;
+        }
+    });
+    ios.run();
+    t.join();
+
+    REQUIRE(received_ok == ct);
+    REQUIRE(sent == ct);
+    REQUIRE(bytes == ct * parts * 100);
+    REQUIRE(released == ct * parts);
+}
+
+#if ASIO_VERSION >= 101400
+TEST_CASE( "Deferred send of owned multipart messages", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    // the parts are taken when async_send is called, so the caller's vector
+    // can be refilled for the next message before the first send starts
+    azmq::message_vector msgs{ azmq::message("a"), azmq::message("bb") };
+    auto send_first = sc.async_send(std::move(msgs), test::deferred);
+    REQUIRE(msgs.empty());
+    msgs = { azmq::message("ccc") };
+    azmq::small_message_vector small{ azmq::message("dddd") };
+    auto send_second = sc.async_send(std::move(msgs), test::deferred);
+    auto send_third = sc.async_send(std::move(small), test::deferred);
+    msgs.clear();
+
+    size_t bytes = 0;
+    auto count = [&](asio::error_code const& ec, size_t bytes_transferred) {
+        if (!ec) bytes += bytes_transferred;
+    };
+    send_first(count);
+    send_second(count);
+    send_third(count);
+    ios.run();
+
+    REQUIRE(bytes == 10);
+    azmq::message_vector in;
+    sb.receive_more(in, 0);
+    REQUIRE(in.size() == 2);
+    REQUIRE(in[0].string() == "a");
+    REQUIRE(in[1].string() == "bb");
+    in.clear();
+    sb.receive_more(in, 0);
+    REQUIRE(in.size() == 1);
+    REQUIRE(in[0].string() == "ccc");
+    in.clear();
+    sb.receive_more(in, 0);
+    REQUIRE(in.size() == 1);
+    REQUIRE(in[0].string() == "dddd");
+}
+#endif
+
+TEST_CASE( "Async send batch", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PULL);
+    sb.set_option(azmq::socket::rcv_hwm(2));
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PUSH);
+    sc.set_option(azmq::socket::snd_hwm(2));
+    sc.connect(subj(__func__));
+
+    size_t ct = 100;
+    azmq::message_vector msgs;
+    for (auto i = 0u; i < ct; ++i)
+        msgs.emplace_back(asio::buffer(&i, sizeof(i)));
+
+    asio::error_code ecc;
+    size_t ctc = 0;
+    size_t btc = 0;
+    sc.async_send_batch(std::move(msgs), [&](asio::error_code const& ec,
+                                             size_t messages_sent,
+                                             size_t bytes_transferred) {
+        ecc = ec;
+        ctc = messages_sent;
+        btc = bytes_transferred;
+    });
+
+    size_t ctb = 0;
+    bool in_order = true;
+    std::function<void()> receive = [&] {
+        sb.async_receive([&](asio::error_code const& ec, azmq::message & msg, size_t) {
+            if (ec)
+                return;
+            in_order = in_order && msg.buffer_cast<unsigned>() == ctb;
+            if (++ctb < ct)
+                receive();
+        });
+    };
+    receive();
+    ios.run();
+
+    REQUIRE(ecc == asio::error_code());
+    REQUIRE(ctc == ct);
+    REQUIRE(btc == ct * sizeof(unsigned));
+    REQUIRE(ctb == ct);
+    REQUIRE(in_order);
+
+    // an lvalue range and handler are copied into the op
+    azmq::message_vector more{ azmq::message("x"), azmq::message("y") };
+    size_t ctl = 0;
+    {
+        auto handler = [&ctl](asio::error_code const& ec, size_t messages_sent, size_t) {
+            if (!ec) ctl = messages_sent;
+        };
+        sc.async_send_batch(more, handler);
+    }
+    ios.reset();
+    ios.run();
+    REQUIRE(ctl == 2);
+    REQUIRE(more.size() == 2);
+    for (auto expected : { "x", "y" }) {
+        azmq::message m;
+        sb.receive(m);
+        REQUIRE(m.string() == expected);
+    }
+
+#if ASIO_VERSION >= 101400
+    // completion tokens work as for the other operations
+    auto send = sc.async_send_batch(azmq::message_vector{ azmq::message("z") }, test::deferred);
+    size_t ctd = 0;
+    send([&ctd](asio::error_code const& ec, size_t messages_sent, size_t) {
+        if (!ec) ctd = messages_sent;
+    });
+    ios.reset();
+    ios.run();
+    REQUIRE(ctd == 1);
+    azmq::message m;
+    sb.receive(m);
+    REQUIRE(m.string() == "z");
+#endif
+}
+
+TEST_CASE( "Send/Receive nocopy", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    std::array<char, 1024> payload;
+    payload.fill('x');
+    std::array<asio::const_buffer, 2> bufs = {{
+        asio::buffer("A"),
+        asio::buffer(payload)
+    }};
+
+    REQUIRE(sc.send(azmq::nocopy, bufs) == 1026);
+
+    azmq::message_vector v;
+    REQUIRE(sb.receive_more(v, 0) == 1026);
+    REQUIRE(v.size() == 2);
+    // inproc delivers the caller's buffer itself
+    REQUIRE(asio::buffer_cast<void const*>(v[1].cbuffer()) == static_cast<void const*>(payload.data()));
+}
+
+TEST_CASE( "Async send nocopy completes after frames are released", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    std::array<char, 1024> payload;
+    payload.fill('x');
+    std::array<asio::const_buffer, 2> bufs = {{
+        asio::buffer(payload.data(), 512),
+        asio::buffer(payload.data() + 512, 512)
+    }};
+
+    bool completed = false;
+    asio::error_code ecc;
+    size_t btc = 0;
+    {
+        // the op holds a copy of the handler, which is long gone by the time
+        // the frames are released
+        auto handler = [&](asio::error_code const& ec, size_t bytes_transferred) {
+            completed = true;
+            ecc = ec;
+            btc = bytes_transferred;
+        };
+        sc.async_send(azmq::nocopy, bufs, handler);
+    }
+
+    // the receiver still references both frames, the op's outstanding work
+    // would keep run() from returning
+    ios.poll();
+    ios.reset();
+    REQUIRE(!completed);
+
+    {
+        azmq::message_vector v;
+        sb.receive_more(v, 0);
+        REQUIRE(v.size() == 2);
+        REQUIRE(!completed);
+    }
+
+    ios.run();
+    REQUIRE(completed);
+    REQUIRE(ecc == asio::error_code());
+    REQUIRE(btc == 1024);
+
+    auto sent = sc.async_send(azmq::nocopy, bufs, asio::use_future);
+    ios.reset();
+    ios.poll();
+    {
+        azmq::message_vector v;
+        sb.receive_more(v, 0);
+    }
+    ios.reset();
+    ios.run();
+    REQUIRE(sent.get() == 1024);
+}
+
+TEST_CASE( "Async send nocopy on a strand completes through the strand", "[socket]" ) {
+    asio::io_service ios;
+    asio::io_service::strand strand(ios);
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(strand, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    std::array<char, 512> payload;
+    payload.fill('x');
+    std::array<asio::const_buffer, 1> bufs = {{ asio::buffer(payload) }};
+
+    bool on_strand = false;
+    strand.dispatch([&] {
+        sc.async_send(azmq::nocopy, bufs, [&](asio::error_code const& ec, size_t) {
+            REQUIRE(!ec);
+            on_strand = strand.running_in_this_thread();
+        });
+    });
+    ios.poll();
+    ios.reset();
+
+    // the frame is released here, outside the strand
+    {
+        azmq::message_vector v;
+        sb.receive_more(v, 0);
+        REQUIRE(v.size() == 1);
+    }
+    ios.run();
+    REQUIRE(on_strand);
+}
+
+TEST_CASE( "Async send nocopy outlives its socket and strand", "[socket]" ) {
+    asio::io_service ios;
+    std::unique_ptr<asio::io_service::strand> strand(new asio::io_service::strand(ios));
+    asio::io_service::strand same(*strand);
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    std::unique_ptr<azmq::socket> sc(new azmq::socket(*strand, ZMQ_PAIR));
+    sc->connect(subj(__func__));
+
+    std::array<char, 512> payload;
+    payload.fill('x');
+    std::array<asio::const_buffer, 1> bufs = {{ asio::buffer(payload) }};
+
+    bool completed = false;
+    bool on_strand = false;
+    sc->async_send(azmq::nocopy, bufs, [&](asio::error_code const& ec, size_t) {
+        REQUIRE(!ec);
+        completed = true;
+        on_strand = same.running_in_this_thread();
+    });
+    ios.poll();
+    ios.reset();
+    REQUIRE(!completed);
+
+    // the sending socket and the strand object it was opened on are gone
+    // before libzmq releases the frame
+    sc.reset();
+    strand.reset();
+    {
+        azmq::message_vector v;
+        sb.receive_more(v, 0);
+        REQUIRE(v.size() == 1);
+    }
+    ios.run();
+    REQUIRE(completed);
+    REQUIRE(on_strand);
+}
+
+TEST_CASE( "Async send/receive on a strand", "[socket]" ) {
+    asio::io_service ios;
+    asio::io_service::strand strand_b(ios);
+    asio::io_service::strand strand_c(ios);
+
+    azmq::socket sb(strand_b, ZMQ_PULL);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(strand_c, ZMQ_PUSH);
+    sc.connect(subj(__func__));
+
+    const size_t count = 1000;
+    std::atomic<size_t> received{ 0 };
+    std::atomic<size_t> outside_strand{ 0 };
+    std::array<char, 16> buf;
+
+    struct receiver {
+        azmq::socket & s_;
+        asio::io_service::strand & strand_;
+        std::array<char, 16> & buf_;
+        std::atomic<size_t> & received_;
+        std::atomic<size_t> & outside_strand_;
+        size_t count_;
+
+        void operator()(asio::error_code const& ec, size_t) {
+            if (ec) return;
+            if (!strand_.running_in_this_thread()) ++outside_strand_;
+            if (++received_ < count_)
+                s_.async_receive(asio::buffer(buf_), receiver(*this));
+        }
+    };
+
+    // send ops copy the buffer sequence, not the bytes it refers to, which
+    // must outlive them; a string literal always does
+    auto const snd_buf = asio::buffer("hello");
+
+    struct sender {
+        azmq::socket & s_;
+        decltype(snd_buf) & buf_;
+        asio::io_service::strand & strand_;
+        std::atomic<size_t> & outside_strand_;
+        size_t remaining_;
+
+        void operator()(asio::error_code const& ec, size_t) {
+            if (ec) return;
+            if (!strand_.running_in_this_thread()) ++outside_strand_;
+            if (--remaining_)
+                s_.async_send(buf_, sender{ s_, buf_, strand_, outside_strand_, remaining_ });
+        }
+    };
+
+    strand_b.dispatch([&] {
+        sb.async_receive(asio::buffer(buf), receiver{ sb, strand_b, buf, received, outside_strand, count });
+    });
+    strand_c.dispatch([&] {
+        sc.async_send(snd_buf, sender{ sc, snd_buf, strand_c, outside_strand, count });
+    });
+
+    std::vector<std::thread> threads;
+    for (auto i = 0; i < 4; ++i)
+        threads.emplace_back([&] { ios.run(); });
+    for (auto & t : threads)
+        t.join();
+
+    REQUIRE(received == count);
+    REQUIRE(outside_strand == 0);
+}
+
+TEST_CASE( "Socket on a strand outlives the strand object", "[socket]" ) {
+    asio::io_service ios;
+    std::unique_ptr<asio::io_service::strand> strand(new asio::io_service::strand(ios));
+
+    azmq::socket sb(*strand, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    // completions run through the socket's copy, which refers to the same
+    // strand as the object it was given
+    asio::io_service::strand same(*strand);
+    strand.reset();
+
+    bool on_strand = false;
+    std::array<char, 16> buf;
+    sb.async_receive(asio::buffer(buf), [&](asio::error_code const& ec, size_t) {
+        REQUIRE(!ec);
+        on_strand = same.running_in_this_thread();
+    });
+    sc.send(asio::buffer("hello"));
+    ios.run();
+    REQUIRE(on_strand);
+}
+
+TEST_CASE( "Async request/reply with sticky registration", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_REP);
+    sb.set_option(azmq::socket::sticky_registration(1000));
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_REQ);
+    sc.set_option(azmq::socket::sticky_registration(1000));
+    sc.connect(subj(__func__));
+
+    const size_t count = 100;
+    size_t replies = 0;
+    auto const snd_buf = asio::buffer("ping");
+    std::array<char, 8> buf_b;
+    std::array<char, 8> buf_c;
+
+    std::function<void()> serve = [&] {
+        sb.async_receive(asio::buffer(buf_b), [&](asio::error_code const& ec, size_t) {
+            if (ec) return;
+            sb.send(snd_buf);
+            serve();
+        });
+    };
+
+    std::function<void()> request = [&] {
+        sc.send(snd_buf);
+        sc.async_receive(asio::buffer(buf_c), [&](asio::error_code const& ec, size_t) {
+            if (ec) return;
+            if (++replies < count)
+                request();
+            else
+                ios.stop();
+        });
+    };
+
+    serve();
+    request();
+    ios.run();
+    REQUIRE(replies == count);
+}
+
+TEST_CASE( "Socket stats are not compiled in by default", "[socket]" ) {
+    asio::io_service ios;
+    azmq::socket s(ios, ZMQ_PAIR);
+
+    asio::error_code ec;
+    azmq::socket::stats stats;
+    s.get_option(stats, ec);
+    REQUIRE(ec == std::errc::not_supported);
+
+    azmq::socket::latency latency;
+    s.get_option(latency, ec);
+    REQUIRE(ec == std::errc::not_supported);
+
+    s.set_option(azmq::socket::track_latency(true), ec);
+    REQUIRE(ec == std::errc::not_supported);
+}
+
+TEST_CASE( "Async send/receive with completion tokens", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    std::array<char, 16> buf;
+    auto const rcv_buf = asio::buffer(buf);
+    auto received = sb.async_receive(rcv_buf, asio::use_future);
+    auto msg = sb.async_receive_message(asio::use_future);
+    auto more = sb.async_receive_more(rcv_buf, asio::use_future);
+
+    auto const hello = asio::buffer("hello");
+    auto sent = sc.async_send(hello, asio::use_future);
+    auto sent_more = sc.async_send(azmq::message("part"), asio::use_future, ZMQ_SNDMORE);
+    auto sent_last = sc.async_send(azmq::message("last"), asio::use_future);
+
+    ios.run();
+
+    REQUIRE(sent.get() == 6);
+    REQUIRE(sent_more.get() == 4);
+    REQUIRE(sent_last.get() == 4);
+    REQUIRE(received.get() == 6);
+    auto m = msg.get();
+    REQUIRE(m.string() == "part");
+    REQUIRE(m.more());
+    auto last = more.get();
+    REQUIRE(last.first == 4);
+    REQUIRE(last.second == false);
+}
+
+#if ASIO_VERSION >= 101400
+namespace {
+    // every argument of the initiating functions is gone by the time the
+    // deferred operations start
+    std::array<char, 6> const deferred_payload = {{ 'h', 'e', 'l', 'l', 'o', 0 }};
+
+    test::deferred_op<void(asio::error_code, size_t)>
+    deferred_send(azmq::socket & s) {
+        std::array<asio::const_buffer, 1> bufs = {{ asio::buffer(deferred_payload) }};
+        return s.async_send(bufs, test::deferred);
+    }
+
+    test::deferred_op<void(asio::error_code, size_t)>
+    deferred_receive(azmq::socket & s, std::array<char, 16> & buf) {
+        std::array<asio::mutable_buffer, 1> bufs = {{ asio::buffer(buf) }};
+        return s.async_receive(bufs, test::deferred);
+    }
+}
+
+TEST_CASE( "Async send/receive with a deferred completion token", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    std::array<char, 16> buf;
+    buf.fill('x');
+    auto receive = deferred_receive(sb, buf);
+    auto receive_msg = sb.async_receive_message(test::deferred);
+    auto send = deferred_send(sc);
+    auto send_part = sc.async_send(azmq::message("part"), test::deferred, ZMQ_SNDMORE);
+    auto send_last = sc.async_send(azmq::message("last"), test::deferred);
+    azmq::message_vector parts;
+    auto receive_parts = sb.async_receive_multipart(parts, test::deferred);
+
+    // nothing has started yet
+    asio::error_code ec;
+    REQUIRE(sb.receive(asio::buffer(buf), ZMQ_DONTWAIT, ec) == 0);
+    REQUIRE(ec.value() == EAGAIN);
+
+    size_t received = 0;
+    std::string msg;
+    size_t sent = 0;
+    size_t parts_received = 0;
+    receive([&](asio::error_code const& ec, size_t bytes) {
+        if (!ec) received = bytes;
+    });
+    receive_msg([&](asio::error_code const& ec, azmq::message m) {
+        if (!ec) msg = m.string();
+    });
+    receive_parts([&](asio::error_code const& ec, size_t bytes) {
+        if (!ec) parts_received = bytes;
+    });
+    auto count_sent = [&](asio::error_code const& ec, size_t bytes) {
+        if (!ec) sent += bytes;
+    };
+    send(count_sent);
+    send_part(count_sent);
+    send_last(count_sent);
+
+    ios.run();
+
+    REQUIRE(sent == 14);
+    REQUIRE(received == 6);
+    REQUIRE(std::string(buf.data()) == "hello");
+    REQUIRE(msg == "part");
+    REQUIRE(parts_received == 4);
+    REQUIRE(parts.size() == 1);
+    REQUIRE(parts[0].string() == "last");
+}
+#endif
+
+#if ASIO_VERSION >= 101100
+namespace {
+    template<typename T>
+    struct counting_allocator {
+        using value_type = T;
+
+        explicit counting_allocator(int & count) : count_(&count) { }
+
+        template<typename U>
+        counting_allocator(counting_allocator<U> const& other) : count_(other.count_) { }
+
+        T* allocate(size_t n) {
+            ++*count_;
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T* p, size_t) {
+            --*count_;
+            ::operator delete(p);
+        }
+
+        template<typename U>
+        bool operator==(counting_allocator<U> const& other) const { return count_ == other.count_; }
+
+        template<typename U>
+        bool operator!=(counting_allocator<U> const& other) const { return count_ != other.count_; }
+
+        int* count_;
+    };
+
+    template<typename Handler>
+    struct with_allocator {
+        using allocator_type = counting_allocator<void>;
+
+        allocator_type get_allocator() const noexcept { return alloc_; }
+
+        void operator()(asio::error_code const& ec, size_t bytes_transferred) {
+            handler_(ec, bytes_transferred);
+        }
+
+        Handler handler_;
+        allocator_type alloc_;
+    };
+
+    template<typename Handler>
+    with_allocator<Handler> make_with_allocator(Handler handler, int & count) {
+        return with_allocator<Handler>{ std::move(handler), counting_allocator<void>(count) };
+    }
+} // namespace
+
+TEST_CASE( "Async completion honours associated executor and allocator", "[socket]" ) {
+    asio::io_service ios;
+    asio::io_service::strand strand(ios);
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    int outstanding = 0;
+    bool on_strand = false;
+    size_t received = 0;
+    std::array<char, 16> buf;
+    auto const rcv_buf = asio::buffer(buf);
+    sb.async_receive(rcv_buf, asio::bind_executor(strand,
+                                make_with_allocator([&](asio::error_code const& ec, size_t bytes_transferred) {
+                                    REQUIRE(!ec);
+                                    on_strand = strand.running_in_this_thread();
+                                    received = bytes_transferred;
+                                }, outstanding)));
+    REQUIRE(outstanding == 1);
+
+    auto const hello = asio::buffer("hello");
+    sc.async_send(hello, [](asio::error_code const&, size_t) { });
+    ios.run();
+
+    REQUIRE(on_strand);
+    REQUIRE(received == 6);
+    REQUIRE(outstanding == 0);
+}
+#endif
+
+TEST_CASE( "Fan out a shared message", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::shared_message update(std::string(300, 'u'));
+
+    std::vector<std::unique_ptr<azmq::socket>> senders;
+    std::vector<std::unique_ptr<azmq::socket>> receivers;
+    for (auto i = 0; i != 3; ++i) {
+        auto addr = subj(__func__) + std::to_string(i);
+        receivers.emplace_back(new azmq::socket(ios, ZMQ_PAIR));
+        receivers.back()->bind(addr);
+        senders.emplace_back(new azmq::socket(ios, ZMQ_PAIR));
+        senders.back()->connect(addr);
+    }
+
+    size_t sent = 0;
+    for (auto & s : senders)
+        s->async_send(update, [&](asio::error_code const& ec, size_t bytes_transferred) {
+            REQUIRE(!ec);
+            sent += bytes_transferred;
+        });
+    senders.front()->send(update);
+    ios.run();
+
+    REQUIRE(sent == 900);
+    REQUIRE(update.size() == 300);
+    for (auto & r : receivers) {
+        azmq::message m;
+        r->receive(m);
+        REQUIRE(m.string() == update.string());
+    }
+    azmq::message m;
+    receivers.front()->receive(m);
+    REQUIRE(m.size() == 300);
+}
+
+#if ASIO_VERSION >= 101400
+TEST_CASE( "Deferred send of a shared message", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    // the operation holds its own reference, update is gone before it starts
+    std::unique_ptr<azmq::shared_message> update(new azmq::shared_message(std::string(300, 'u')));
+    auto send = sc.async_send(*update, test::deferred);
+    update.reset();
+
+    size_t sent = 0;
+    send([&](asio::error_code const& ec, size_t bytes_transferred) {
+        if (!ec) sent = bytes_transferred;
+    });
+    ios.run();
+
+    REQUIRE(sent == 300);
+    azmq::message m;
+    sb.receive(m);
+    REQUIRE(m.string() == std::string(300, 'u'));
+}
+#endif
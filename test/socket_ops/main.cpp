@@ -4,6 +4,7 @@
 #include <asio/buffer.hpp>
 
 #include <array>
+#include <string>
 #include <chrono>
 #include <thread>
 
@@ -196,3 +197,28 @@ TEST_CASE( "Inproc Send/Receive not enough buffers", "[socket_ops]" ) {
     azmq::detail::socket_ops::receive(rcv_msg_seq_2, sb, 0, ec);
     REQUIRE(ec != asio::error_code());
 }
+
+TEST_CASE( "Inproc Receive single buffer truncates", "[socket_ops]" ) {
+    asio::error_code ec;
+    auto sb = azmq::detail::socket_ops::create_socket(ctx, ZMQ_PAIR, ec);
+    REQUIRE(ec == asio::error_code());
+    auto uri = subj(__func__);
+    azmq::detail::socket_ops::bind(sb, uri, ec);
+    REQUIRE(ec == asio::error_code());
+
+    auto sc = azmq::detail::socket_ops::create_socket(ctx, ZMQ_PAIR, ec);
+    REQUIRE(ec == asio::error_code());
+    azmq::detail::socket_ops::connect(sc, uri, ec);
+    REQUIRE(ec == asio::error_code());
+
+    std::string s("0123456789");
+    azmq::detail::socket_ops::send(azmq::message(s), sc, 0, ec);
+    REQUIRE(ec == asio::error_code());
+
+    std::array<char, 4> buf;
+    std::array<asio::mutable_buffer, 1> rcv_bufs = {{ asio::buffer(buf) }};
+    auto sz = azmq::detail::socket_ops::receive(rcv_bufs, sb, 0, ec);
+    REQUIRE(ec == asio::error_code());
+    REQUIRE(sz == s.size());
+    REQUIRE(std::string(buf.data(), buf.size()) == "0123");
+}
@@ -0,0 +1,184 @@
+/*
+    Copyright (c) 2013-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of azmq
+
+    Distributed under the Boost Software License, Version 1.0. (See accompanying
+    file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+// AZMQ_ENABLE_SOCKET_STATS is a compile definition of this target, see
+// CMakeLists.txt, it must be the same in every translation unit
+#include <azmq/socket.hpp>
+
+#include <asio/buffer.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#define CATCH_CONFIG_MAIN
+#include "../catch.hpp"
+
+std::string subj(const char* name) {
+    return std::string("inproc://") + name;
+}
+
+TEST_CASE( "Socket stats", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    std::array<char, 16> buf;
+    // nothing to read yet, both are queued for the reactor
+    sb.async_receive(asio::buffer(buf), [](asio::error_code const&, size_t) { });
+    sb.async_receive(asio::buffer(buf), [](asio::error_code const&, size_t) { });
+    sc.send(asio::buffer("hello"));
+    // completes speculatively
+    auto const world = asio::buffer("world!");
+    sc.async_send(world, [](asio::error_code const&, size_t) { });
+    ios.run();
+
+    sb.async_receive(asio::buffer(buf), [](asio::error_code const&, size_t) { });
+    sb.cancel();
+    ios.reset();
+    ios.run();
+
+    azmq::socket::stats sc_stats;
+    sc.get_option(sc_stats);
+    REQUIRE(sc_stats.value().messages_sent == 2);
+    REQUIRE(sc_stats.value().bytes_sent == 13);
+    REQUIRE(sc_stats.value().speculative_hits == 1);
+
+    azmq::socket::stats sb_stats;
+    sb.get_option(sb_stats);
+    REQUIRE(sb_stats.value().messages_received == 2);
+    REQUIRE(sb_stats.value().bytes_received == 13);
+    REQUIRE(sb_stats.value().speculative_misses >= 1);
+    REQUIRE(sb_stats.value().reactor_wakeups >= 1);
+    REQUIRE(sb_stats.value().max_queue_depth == 2);
+    REQUIRE(sb_stats.value().cancels == 1);
+}
+
+TEST_CASE( "Socket latency histograms", "[socket]" ) {
+    using histogram = azmq::detail::latency_histogram;
+    for (uint64_t ns : { 0ull, 3ull, 4ull, 5ull, 1000ull, 123456789ull }) {
+        auto b = histogram::bucket(ns);
+        REQUIRE(histogram::lower_bound(b) <= ns);
+        REQUIRE(ns <= histogram::upper_bound(b));
+    }
+    REQUIRE(histogram::bucket(~0ull) == histogram::bucket_count - 1);
+
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    // nothing is recorded until tracking is enabled
+    azmq::socket::track_latency tracking;
+    sb.get_option(tracking);
+    REQUIRE_FALSE(tracking.value());
+    std::array<char, 16> buf;
+    sb.async_receive(asio::buffer(buf), [](asio::error_code const&, size_t) { });
+    sc.send(asio::buffer("hello"));
+    ios.run();
+    azmq::socket::latency untracked;
+    sb.get_option(untracked);
+    REQUIRE(untracked.value().read_reactor.count() == 0);
+    REQUIRE(untracked.value().read_speculative.count() == 0);
+
+    sb.set_option(azmq::socket::track_latency(true));
+    sc.set_option(azmq::socket::track_latency(true));
+    sb.get_option(tracking);
+    REQUIRE(tracking.value());
+
+    ios.reset();
+    sb.async_receive(asio::buffer(buf), [](asio::error_code const&, size_t) { });
+    auto const hello = asio::buffer("hello");
+    sc.async_send(hello, [](asio::error_code const&, size_t) { });
+    ios.run();
+
+    azmq::socket::latency sb_latency;
+    sb.get_option(sb_latency);
+    REQUIRE(sb_latency.value().read_reactor.count() == 1);
+    REQUIRE(sb_latency.value().read_speculative.count() == 0);
+    REQUIRE(sb_latency.value().read_reactor.percentile(0.5) > 0);
+
+    azmq::socket::latency sc_latency;
+    sc.get_option(sc_latency);
+    REQUIRE(sc_latency.value().write_speculative.count() == 1);
+    REQUIRE(sc_latency.value().write_reactor.count() == 0);
+}
+
+TEST_CASE( "Socket stats count whole messages", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    // a message of three parts, sent part by part
+    sc.send(azmq::message("A"), ZMQ_SNDMORE);
+    sc.send(azmq::message("B"), ZMQ_SNDMORE);
+    sc.send(azmq::message("C"));
+    // and another of two parts in one op
+    azmq::message_vector out;
+    out.emplace_back(std::string("DD"));
+    out.emplace_back(std::string("EE"));
+    sc.async_send(std::move(out), [](asio::error_code const&, size_t) { });
+
+    // the first part by itself, then the rest as one multipart op
+    azmq::message msg;
+    sb.receive(msg);
+    azmq::message_vector parts;
+    sb.receive_more(parts, 0);
+    azmq::message_vector next;
+    sb.async_receive_multipart(next, [](asio::error_code const&, size_t) { });
+    ios.run();
+    REQUIRE(parts.size() == 2);
+    REQUIRE(next.size() == 2);
+
+    azmq::socket::stats sc_stats;
+    sc.get_option(sc_stats);
+    REQUIRE(sc_stats.value().messages_sent == 2);
+    REQUIRE(sc_stats.value().bytes_sent == 7);
+
+    azmq::socket::stats sb_stats;
+    sb.get_option(sb_stats);
+    REQUIRE(sb_stats.value().messages_received == 2);
+    REQUIRE(sb_stats.value().bytes_received == 7);
+}
+
+TEST_CASE( "Socket stats count only bytes that fit a single buffer", "[socket]" ) {
+    asio::io_service ios;
+
+    azmq::socket sb(ios, ZMQ_PAIR);
+    sb.bind(subj(__func__));
+
+    azmq::socket sc(ios, ZMQ_PAIR);
+    sc.connect(subj(__func__));
+
+    sc.send(asio::buffer("truncated"));
+    sc.send(asio::buffer("truncated"));
+
+    std::array<char, 4> buf;
+    REQUIRE(sb.receive(asio::buffer(buf)) == 10);
+    size_t btb = 0;
+    sb.async_receive(asio::buffer(buf), [&](asio::error_code const&, size_t bt) { btb = bt; });
+    ios.run();
+    REQUIRE(btb == 10);
+
+    azmq::socket::stats sb_stats;
+    sb.get_option(sb_stats);
+    REQUIRE(sb_stats.value().messages_received == 2);
+    REQUIRE(sb_stats.value().bytes_received == 8);
+}